@@ -36,6 +36,7 @@ public:
 
     void addShaderDefinition(const std::string& placeholder, const std::string& filePath);
     void removeShaderDefinition(const std::string &placeholder);
+    void setShaderDefinitionEnabled(const std::string &placeholder, bool enabled);
 
     bool GetVsyncStatus() const;
     void SetVsyncStatus(bool status);
@@ -65,6 +66,7 @@ protected:
     [[nodiscard]] float DeltaTime() const;
 
     void DispatchComputeShader(GLuint computeShaderProgram, int itemsX, int itemsY, int itemsZ) const;
+    void DispatchComputeShaderIndirect(GLuint computeShaderProgram, GLuint indirectBuffer, GLintptr offset = 0) const;
 
     bool displayFramerate = false;
     InputManager inputManager;
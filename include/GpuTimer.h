@@ -0,0 +1,41 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glad/glad.h>
+
+// Measures the GPU time between begin() and end() with GL_TIME_ELAPSED queries.
+// Results are read back a few frames late so the CPU never waits on the GPU.
+// Only one timer can be running at a time, they cannot be nested.
+class GpuTimer {
+public:
+    GpuTimer() = default;
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Most recent finished measurement, in milliseconds
+    [[nodiscard]] float getMilliseconds() const;
+
+    // True once at least one measurement has come back
+    [[nodiscard]] bool hasResult() const;
+
+private:
+    static constexpr int QUERY_COUNT = 4;
+
+    void collectResults();
+
+    GLuint queries[QUERY_COUNT]{};
+    bool pending[QUERY_COUNT]{};
+    unsigned long long submitted[QUERY_COUNT]{}; // Order the queries were issued in
+    unsigned long long submissionCount = 0;
+    unsigned long long latestCollected = 0;
+    int activeQuery = -1;
+    float milliseconds = 0.0f;
+    bool measured = false;
+};
+
+#endif // GPUTIMER_H
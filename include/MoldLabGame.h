@@ -2,6 +2,7 @@
 #define MOLDLABGAME_H
 
 #include "GameEngine.h"
+#include "GpuTimer.h"
 #include "ShaderVariable.h"
 #include "SimulationData.h"
 #include "Spore.h"
@@ -17,13 +18,37 @@ struct SimulationDefaults {
     static constexpr float SPORE_TURN_SPEED = 1.0f;
     static constexpr float SPORE_ROTATION_SPEED = 1.0f;
     static constexpr int SDF_REDUCTION_FACTOR = 2;
-
-    static constexpr float MAX_SPORE_COUNT = 1'000'000;
-    static constexpr float MAX_GRID_SIZE = 500;
+    static constexpr int MAX_SDF_REDUCTION = 8;
+    static constexpr float TARGET_FRAME_TIME = 16.6f; // Milliseconds of GPU time the adaptive SDF reduction aims for
+    static constexpr float SDF_ADAPT_INTERVAL = 2.0f; // Seconds between adaptive SDF reduction decisions
+    static constexpr float RENDER_SCALE = 0.5f; // Internal resolution of the ray march when upscaling
+    static constexpr float MIN_RENDER_SCALE = 0.5f;
+    static constexpr float RENDER_SCALE_STEP = 0.1f; // Most the dynamic resolution changes the scale by at once
+    static constexpr float RENDER_SCALE_INCREMENT = 0.05f; // Scales it picks from, so small swings keep the render target
+    static constexpr float RENDER_SCALE_HYSTERESIS = 0.8f; // Fraction of the target frame time below which the scale goes back up
+    static constexpr int RENDER_SCALE_SETTLE_FRAMES = 5; // Timer results lag a few frames behind a resolution change
+    static constexpr float AMORTIZED_JFA_BUDGET = 1.0f; // GPU milliseconds per frame the amortized JFA spreads its passes to
+    static constexpr float DEPOSIT_AMOUNT = 0.25f;
+    static constexpr float DIFFUSE_SPEED = 5.0f;
+    static constexpr int SORT_INTERVAL = 30;
+    static constexpr int TEMPORAL_JFA_PASSES = 3;
+    static constexpr int JFA_REBUILD_INTERVAL = 30;
+
+    static constexpr float MAX_SPORE_COUNT = 10'000'000;
+    static constexpr float MAX_GRID_SIZE = 1024; // The SDF packs its seed cells 10 bits per axis, the grid is only allocated at grid_size
 };
 
 
 
+// Result of MoldLabGame::compareSDFBuilders(), distances in voxels
+struct SDFComparison {
+    float meanError = 0.0f;
+    float maxError = 0.0f;
+    float mismatchFraction = 0.0f;
+    unsigned int mismatchedCells = 0;
+    bool measured = false;
+};
+
 struct InputState {
     bool isDPressed = false;
     bool isAPressed = false;
@@ -48,9 +73,14 @@ protected:
     void renderUI() override;
 
 private:
-    GLuint triangleVbo = 0, triangleVao = 0, voxelGridTexture = 0, simulationSettingsBuffer = 0, sporesBuffer = 0, sdfTexBuffer1 = 0, sdfTexBuffer2 = 0;
-    GLuint shaderProgram = 0, drawSporesShaderProgram = 0, moveSporesShaderProgram = 0, decaySporesShaderProgram = 0, jumpFloodInitShaderProgram = 0, jumpFloodStepShaderProgram = 0, clearGridShaderProgram = 0, randomizeSporesShaderProgram = 0, scaleSporesShaderProgram = 0;
-    ShaderVariable<int> jfaStepSV, maxSporeSizeSV;
+    GLuint triangleVbo = 0, triangleVao = 0, voxelGridTexture = 0, diffusedVoxelGridTexture = 0, depositGridTexture = 0, simulationSettingsBuffer = 0, sporePositionsBuffer = 0, sporeOrientationsBuffer = 0, activeBrickBuffer = 0, nextBrickBuffer = 0, brickStampBuffer = 0,
+           sortKeysBuffer = 0, sortValuesBuffer = 0, sortedKeysBuffer = 0, sortedValuesBuffer = 0, sortHistogramBuffer = 0, sortedSporePositionsBuffer = 0, sortedSporeOrientationsBuffer = 0, sdfTexBuffer1 = 0, sdfTexBuffer2 = 0, sdfTexBuffer3 = 0, brickTableTexture = 0, brickPoolBuffer = 0, occupancyTexture = 0, pyramidTexture = 0,
+           renderTargetTexture = 0, renderTargetFramebuffer = 0, historyTexture1 = 0, historyTexture2 = 0,
+           depthCacheTexture1 = 0, depthCacheTexture2 = 0, depthCacheFramebuffer = 0, coneDistanceTexture = 0;
+    GLuint shaderProgram = 0, drawSporesShaderProgram = 0, moveSporesShaderProgram = 0, stepSporesShaderProgram = 0, decaySporesShaderProgram = 0, decayDiffuseShaderProgram = 0, jumpFloodInitShaderProgram = 0, jumpFloodReseedShaderProgram = 0, jumpFloodStepShaderProgram = 0, jumpFloodAxisStepShaderProgram = 0, compareSDFShaderProgram = 0, clearGridShaderProgram = 0, clearActiveBricksShaderProgram = 0, prepareBrickDispatchShaderProgram = 0, resolveDepositsShaderProgram = 0,
+           mortonKeysShaderProgram = 0, radixCountShaderProgram = 0, radixScanShaderProgram = 0, radixScatterShaderProgram = 0, reorderSporesShaderProgram = 0, randomizeSporesShaderProgram = 0, scaleSporesShaderProgram = 0, resampleGridShaderProgram = 0, rebaseDecayClockShaderProgram = 0, buildPyramidBaseShaderProgram = 0, buildPyramidShaderProgram = 0, renderTilesShaderProgram = 0, upscaledRenderTilesShaderProgram = 0, temporalUpscaleShaderProgram = 0, coneMarchShaderProgram = 0;
+    ShaderVariable<vec2> coneRenderSizeSV;
+    ShaderVariable<int> jfaStepSV, jfaAxisStepSV, jfaAxisSV, maxSporeSizeSV, sporeOffsetSV, sourceGridSizeSV, sourcePoolSideSV, allocateBricksSV, radixCountShiftSV, radixScatterShiftSV, checkerboardPhaseSV, historyValidSV;
 
     SimulationData simulationSettings{};
 
@@ -59,28 +89,127 @@ private:
     float orbitRadius = SimulationDefaults::GRID_SIZE * 1.25;    // Distance from the origin
 
     bool useTransparency = true;
+    bool pyramidMarch = false; // Opaque ray march skips empty space with the trail pyramid instead of the SDF
+    bool computeRenderer = false; // Ray march in compute shader tiles instead of the full-screen quad's fragment shader
+    int renderTargetWidth = 0, renderTargetHeight = 0; // Size the compute renderer's image was allocated at
+    bool temporalUpscale = false; // March at renderScale and reproject the previous frame to fill in the screen resolution
+    bool checkerboardRendering = false; // March half of the pixels each frame
+    float renderScale = SimulationDefaults::RENDER_SCALE;
+    bool dynamicResolution = false; // Pick renderScale from the measured GPU time instead of the UI
+    int renderScaleSettleFrames = 0; // Frames left before the dynamic resolution trusts the timers again
+    int historyWidth = 0, historyHeight = 0;
+    int historyValid = 0; // Int as it is uploaded as is, 0 when the history holds nothing to reproject
+    int checkerboardPhase = -1;
+    bool depthCache = false; // Start rays near last frame's reprojected hits instead of at the grid bounds
+    int depthCacheWidth = 0, depthCacheHeight = 0;
+    bool conePrepass = false; // Start each 8x8 pixel block's rays where a cone marched against the SDF stopped
+    int coneDistanceWidth = 0, coneDistanceHeight = 0; // In blocks
+    vec2 coneRenderSize{};
     bool wrapGrid = true;
-    bool gridSizeChanged = false;
+    bool tiledView = false; // Opaque ray march through repeating copies of the wrapped grid
+    bool fuseSporeStep = true;
+    bool atomicDeposit = false;
+    bool useDiffusion = false;
+    bool separableDiffusion = true;
+    bool sortSpores = false;
+    int sortInterval = SimulationDefaults::SORT_INTERVAL; // Frames between Morton re-sorts
+    int allocatedGridSize = 0; // Side length the grid textures were allocated with, reallocateGrid() catches up to grid_size
+    int voxelFormat = 0; // Index into VOXEL_FORMATS in MoldLabGame.cpp, R32F by default
+    int allocatedVoxelFormat = 0;
+    bool sparseGrid = false; // Trails live in a pool of bricks behind a brick table instead of a dense texture
+    bool allocatedSparseGrid = false;
+    int sparsePoolLayers = 0; // Layers of sparse_pool_side^2 bricks the pool has, growBrickPool() adds more
+    int sparsePoolMaxLayers = 0;
+    int sparsePoolFreeBricks = 0; // As of the last checkBrickPool()
+    int sparsePoolDroppedBricks = 0; // Allocations that found the pool full and could not grow it
+    bool temporalJFA = false; // Reseed the SDF from the previous frame instead of rebuilding it
+    int temporalJFAPasses = SimulationDefaults::TEMPORAL_JFA_PASSES;
+    int jfaRebuildInterval = SimulationDefaults::JFA_REBUILD_INTERVAL; // Frames between full SDF rebuilds in temporal mode
+    int framesSinceSDFRebuild = 0;
+    bool sdfHistoryValid = false; // False until the SDF textures hold a finished SDF of the current size
+    bool separableJFA = false; // Per-axis jump flood steps instead of the 26 neighbour ones
+    SDFComparison sdfComparison;
+    bool amortizedJFA = false; // Spread full SDF rebuilds over several frames, rendering the last finished one
+    int amortizedJFAPass = 0; // Next pass of the build in progress, 0 being the init pass
+    int amortizedJFAPassesPerFrame = 1;
+    int amortizedJFAFrames = 1; // Frames the build in progress is spread over
+    bool amortizedJFASeparable = false; // Separable mode of the build in progress, its pass order depends on it
+    float sdfBuildStartTime = 0.0f; // simulation_time the build in progress was seeded at
+    int sdfBuildStartFrame = 0;
+    float completedSDFStartTime = 0.0f; // simulation_time the SDF in sdfTexBuffer1 was seeded at
+    int completedSDFStartFrame = 0;
+    int pyramidBaseSize = 0; // Side length of the trail pyramid's level 0
+    bool adaptiveSDFReduction = false; // Pick sdf_reduction from the measured GPU time instead of the UI
+    float targetFrameTime = SimulationDefaults::TARGET_FRAME_TIME;
+    float sdfAdaptElapsed = 0.0f; // Seconds since the adaptive SDF reduction last decided
 
     InputState inputState;
 
+    int sporeCapacity = 0; // Spores the spore buffer has room for
+    int liveSporeCount = 0; // Spores that have been initialized, the rest of the capacity is garbage
+    int sortCapacity = 0;  // Spores the sort buffers have room for
+    GpuTimer sortTimer;
+    GpuTimer jfaTimer;
+    GpuTimer simulationTimer; // Decay through deposit, without the sort which has its own timer
+    GpuTimer renderTimer;
+
     // Initialization Functions
-    void initializeRenderShader(bool useTransparency);
+    void initializeRenderShader(bool useTransparency, bool pyramidMarch, bool tiledView, bool depthCache, bool conePrepass);
     void initializeMoveSporesShader(bool wrapAround);
+    void initializeDepositShaders(bool atomicDeposit);
+    void initializeDiffusionShader(bool separableKernel);
+    void initializeJumpFloodShaders();
 
     void initializeShaders();
+    void initializeGridShaders();
+    void initializeResampleShader(bool sparseSource);
     void initializeUniformVariables();
     void initializeVertexBuffers();
     void initializeVoxelGridBuffer();
-    void initializeSDFBuffer();
+    bool initializeDepositGridBuffer();
+    bool initializeDiffusedVoxelGridBuffer();
+    bool initializeSDFBuffer();
+    bool initializePyramidBuffer();
+    bool initializeRenderTarget(int width, int height);
+    bool initializeHistoryTextures(int width, int height);
+    void bindDepthCache(int width, int height);
+    void clearDepthCache() const;
+    void coneMarch(int width, int height);
     void initializeSimulationBuffers();
+    void initializeBrickBuffers(int gridSize);
+    void initializeSortBuffers(int capacity);
+    bool resizeSporeBuffers(int capacity, int keepCount);
+    GLuint createSparseGrid(GLenum internalFormat, int gridSize);
+    bool checkBrickPool();
+    bool growBrickPool();
 
     // Update Helpers
     void HandleCameraMovement(float orbitRadius, float deltaTime);
     void DispatchComputeShaders();
-    void executeJFA() const;
+    void decayAndDiffuse();
+    void executeJFA();
+    void buildTrailPyramid() const;
+    void jumpFlood(bool rebuild, bool separable);
+    bool renderTiles();
+    void blitToScreen(GLuint texture, int width, int height) const;
+    void amortizedJumpFlood();
+    void dispatchJFAPass(GLuint program, GLuint readTexture, GLuint writeTexture) const;
+    [[nodiscard]] int firstJFAStepSize() const;
+    [[nodiscard]] float sdfMargin() const;
+    [[nodiscard]] int sdfGridSize() const;
+    void setSDFReduction(int reduction);
+    void adaptSDFReduction(float deltaTime);
+    void adaptRenderScale();
+    void compareSDFBuilders();
+    void finishBrickLists();
+    void sortSporesByMortonCode();
+    void updateSporeCount();
+    void rebaseSimulationTime();
+    void reallocateGrid();
+    void randomizeSpores(int firstSpore, int count) const;
     void resetSporesAndGrid() const;
     void clearGrid() const;
+    void clearEntireGrid() const;
 };
 
 #endif // MOLDLABGAME_H
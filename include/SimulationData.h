@@ -12,9 +12,17 @@ struct SimulationData {
     float sensor_angle;
     vec4 camera_position; // Must be aligned on 16 bytes!!
     vec4 camera_focus; // Must be aligned on 16 bytes!!
+    vec4 previous_camera_position; // Camera of the last rendered frame, to reproject it from
+    vec4 previous_camera_focus;
     float delta_time;
     float grid_resize_factor;
     float aspect_ratio;
+    float deposit_amount;       // Trail added per spore per frame when depositing atomically
+    float diffuse_speed;        // How quickly trails blur into their neighbours
+    int frame_index;            // Incremented every simulation step, stamps the active brick lists
+    int sparse_pool_side;       // Bricks along each side of the sparse brick pool
+    float simulation_time;      // Seconds simulated since the last rebase, lazily decayed voxels are aged against it
+    float sdf_margin;           // Voxels trails may have grown since the rendered SDF was seeded, subtracted from its distances
 };
 
 #endif //SIMULATIONDATA_H
\ No newline at end of file
@@ -1,10 +1,21 @@
 #ifndef SPORE_H
 #define SPORE_H
 
+typedef unsigned int uint; // #DEFINE_REMOVE_FROM_SHADER
 
-struct Spore {
-    vec4 position;   // Position vector: x, y, z
-    mat3 orientation;
+// Spores are stored as structure-of-arrays, each struct below has its own buffer.
+// Both only hold scalars so std430 packs them tightly (12 and 8 bytes per spore).
+
+struct SporePosition {
+    float x;
+    float y;
+    float z;
+};
+
+// Unit quaternion, xy and zw each packed with packSnorm2x16
+struct SporeOrientation {
+    uint xy;
+    uint zw;
 };
 
 #endif //SPORE_H
@@ -0,0 +1,59 @@
+#version 430
+
+#define PYRAMID_BASE
+
+#define SPARSE_GRID
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#ifdef PYRAMID_BASE
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+#else
+// The level below the one being built
+layout(r16f, binding = 1) uniform readonly image3D finerLevel;
+#endif
+
+// Each cell holds the max of the 2x2x2 cells, or voxels for the base level, below it
+layout(r16f, binding = 2) uniform writeonly image3D pyramidLevel;
+
+void main() {
+    ivec3 cell = ivec3(gl_GlobalInvocationID.xyz);
+
+    // The pyramid is padded past the grid so every level halves evenly
+    if (any(greaterThanEqual(cell, imageSize(pyramidLevel)))) {
+        return;
+    }
+
+    float maxValue = 0.0;
+    for (int z = 0; z < 2; ++z) {
+        for (int y = 0; y < 2; ++y) {
+            for (int x = 0; x < 2; ++x) {
+                ivec3 child = cell * 2 + ivec3(x, y, z);
+                #ifdef PYRAMID_BASE
+                // Padding and voxels with a clear occupancy bit are empty without reading the grid
+                if (all(lessThan(child, ivec3(settings.grid_size))) && mayBeOccupied(child)) {
+                    maxValue = max(maxValue, loadVoxel(child));
+                }
+                #else
+                maxValue = max(maxValue, imageLoad(finerLevel, child).x);
+                #endif
+            }
+        }
+    }
+
+    imageStore(pyramidLevel, cell, vec4(maxValue));
+}
@@ -1,19 +1,51 @@
 #version 430
 
+#define ACTIVE_BRICKS_ONLY
+
+#define SPARSE_GRID
 
 // Simulation Settings
 #define SIMULATION_SETTINGS
 
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
-layout(binding = 0, r32f) uniform image3D voxelData;
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
 
 layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
+#define BRICK_TRACKING
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
 
 void main() {
+    #ifdef ACTIVE_BRICKS_ONLY
+    // Dispatched indirectly over the active bricks, everything else is already zero
+    uint brickSlot = activeBrickSlot();
+    if (brickSlot >= activeBricks.brick_count) {
+        return;
+    }
+
+    // No grid bounds check, imageStore() drops the writes of edge bricks that reach past the grid
+    ivec3 brickOrigin = unpackBrick(activeBricks.bricks[brickSlot]) * BRICK_SIZE;
+    ivec3 location = brickOrigin + ivec3(gl_LocalInvocationID.xyz);
+
+    if (gl_LocalInvocationIndex < TILE_OCCUPANCY_WORDS) {
+        imageStore(occupancyData, tileOccupancyWord(brickOrigin, gl_LocalInvocationIndex), uvec4(0u));
+    }
+    #else
+    // Before the bounds check, the invocations clearing the words at the edge of the grid may be outside it
+    if (gl_LocalInvocationIndex < TILE_OCCUPANCY_WORDS) {
+        imageStore(occupancyData, tileOccupancyWord(ivec3(gl_WorkGroupID.xyz) * BRICK_SIZE, gl_LocalInvocationIndex), uvec4(0u));
+    }
+
     // Get the 3D indices of the current work item
     uint x = gl_GlobalInvocationID.x;
     uint y = gl_GlobalInvocationID.y;
@@ -24,5 +56,18 @@ void main() {
         return;
     }
 
-    imageStore(voxelData, ivec3(x, y, z), vec4(0.0));
+    ivec3 location = ivec3(x, y, z);
+    #endif
+
+    storeVoxel(location, 0.0);
+
+    #if defined(ACTIVE_BRICKS_ONLY) && defined(SPARSE_GRID)
+    // Slots have to be zero before they go back into the pool
+    memoryBarrierImage();
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0) {
+        releaseBrick(location / BRICK_SIZE);
+    }
+    #endif
 }
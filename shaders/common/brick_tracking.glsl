@@ -0,0 +1,60 @@
+// Active brick bookkeeping, injected into every compute pass that reads or writes trails.
+// The grid is split into BRICK_SIZE^3 bricks, only bricks holding trail are listed and
+// the decay/clear/resolve passes are dispatched indirectly over that list.
+
+const int BRICK_SIZE = 8;
+const uint MAX_INDIRECT_GROUPS_X = 65535u;
+
+// Bricks that had trail at the end of last frame, the header doubles as glDispatchComputeIndirect arguments
+layout(std430, binding = 2) buffer ActiveBrickBuffer {
+    uint dispatch_x;
+    uint dispatch_y;
+    uint dispatch_z;
+    uint brick_count;
+    uint bricks[];
+} activeBricks;
+
+// Bricks that will have trail at the end of this frame
+layout(std430, binding = 3) buffer NextBrickBuffer {
+    uint dispatch_x;
+    uint dispatch_y;
+    uint dispatch_z;
+    uint brick_count;
+    uint bricks[];
+} nextBricks;
+
+// Frame stamp of the last time each brick was added to nextBricks, so it is only listed once.
+// Sized for the bricks of the allocated grid, which are indexed along x, then y, then z
+layout(std430, binding = 4) buffer BrickStampBuffer {
+    uint brick_stamps[];
+};
+
+uint packBrick(ivec3 brick) {
+    return uint(brick.x) | (uint(brick.y) << 10) | (uint(brick.z) << 20);
+}
+
+ivec3 unpackBrick(uint packedBrick) {
+    return ivec3(packedBrick & 1023u, (packedBrick >> 10) & 1023u, packedBrick >> 20);
+}
+
+// Lists the brick for the next frame, whoever flips the stamp first appends it
+void activateBrick(ivec3 brick) {
+    int bricksPerSide = (settings.grid_size + BRICK_SIZE - 1) / BRICK_SIZE;
+    uint index = uint(brick.x + bricksPerSide * (brick.y + bricksPerSide * brick.z));
+    uint stamp = uint(settings.frame_index + 1);
+
+    // Plain read first, most deposits land in bricks that are already listed
+    if (brick_stamps[index] != stamp && atomicExchange(brick_stamps[index], stamp) != stamp) {
+        uint slot = atomicAdd(nextBricks.brick_count, 1u);
+        nextBricks.bricks[slot] = packBrick(brick);
+    }
+}
+
+void activateVoxelBrick(ivec3 voxel) {
+    activateBrick(voxel / BRICK_SIZE);
+}
+
+// Position in activeBricks.bricks of this workgroup, indirect dispatches fold the list into x and y
+uint activeBrickSlot() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
@@ -0,0 +1,11 @@
+// Linear ids for 1D passes, injected into every shader dispatched over the spores.
+// GameEngine::DispatchComputeShader folds dispatches wider than GL_MAX_COMPUTE_WORK_GROUP_COUNT
+// into rows of work groups, so gl_GlobalInvocationID.x alone would repeat between rows.
+
+uint linearWorkGroupID() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
+
+uint linearInvocationID() {
+    return linearWorkGroupID() * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
+}
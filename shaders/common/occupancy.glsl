@@ -0,0 +1,54 @@
+// One bit per trail voxel, a 4x4x2 block of voxels per r32ui word, so "is anything here" tests read
+// a 32x smaller volume. A clear bit means the voxel is empty, a set bit only that it may hold trail:
+// deposits set bits and the decay passes clear them, lazily decayed grids never clear theirs.
+
+const ivec3 OCCUPANCY_WORD_SIZE = ivec3(4, 4, 2);
+
+layout(binding = 7, r32ui) uniform uimage3D occupancyData;
+
+ivec3 occupancyWord(ivec3 location) {
+    return location / OCCUPANCY_WORD_SIZE;
+}
+
+uint occupancyBit(ivec3 location) {
+    ivec3 p = location % OCCUPANCY_WORD_SIZE;
+    return 1u << uint(p.x + OCCUPANCY_WORD_SIZE.x * (p.y + OCCUPANCY_WORD_SIZE.y * p.z));
+}
+
+bool mayBeOccupied(ivec3 location) {
+    return (imageLoad(occupancyData, occupancyWord(location)).x & occupancyBit(location)) != 0u;
+}
+
+void markOccupied(ivec3 location) {
+    imageAtomicOr(occupancyData, occupancyWord(location), occupancyBit(location));
+}
+
+// 8^3 tiles aligned to the grid own 2x2x4 words outright, which one invocation each can overwrite
+const int TILE_OCCUPANCY_WORDS = 16;
+
+ivec3 tileOccupancyWord(ivec3 tileOrigin, uint index) {
+    return occupancyWord(tileOrigin) + ivec3(index % 2u, (index / 2u) % 2u, index / 4u);
+}
+
+#ifdef TILE_OCCUPANCY
+// Words of this workgroup's tile, built in shared memory and stored whole by storeTileOccupancy()
+shared uint tileOccupancy[TILE_OCCUPANCY_WORDS];
+
+void clearTileOccupancy() {
+    if (gl_LocalInvocationIndex < TILE_OCCUPANCY_WORDS) {
+        tileOccupancy[gl_LocalInvocationIndex] = 0u;
+    }
+}
+
+void markTileOccupied(ivec3 location) {
+    ivec3 word = occupancyWord(location) % ivec3(2, 2, 4);
+    atomicOr(tileOccupancy[word.x + 2 * (word.y + 2 * word.z)], occupancyBit(location));
+}
+
+// Words past the edge of the grid fall outside occupancyData and are dropped
+void storeTileOccupancy(ivec3 tileOrigin) {
+    if (gl_LocalInvocationIndex < TILE_OCCUPANCY_WORDS) {
+        imageStore(occupancyData, tileOccupancyWord(tileOrigin, gl_LocalInvocationIndex), uvec4(tileOccupancy[gl_LocalInvocationIndex]));
+    }
+}
+#endif
@@ -0,0 +1,499 @@
+// Ray marching through the trail grid, shared by the fragment renderer in renderer.glsl and the compute tile
+// renderer in render_tiles.glsl. Injected after the settings buffer, the grid and SDF images, the pyramid sampler
+// and a loadTrailVoxel(ivec3) that returns 0 for empty voxels, which is where the two renderers differ.
+// Under DEPTH_CACHE they also declare the previousDepth and depthCache images, under CONE_PREPASS coneDistances.
+
+vec3 lightColor = vec3(1.0, 1.0, 1.0);    // Pure white light
+vec3 objectColor = vec3(0.0, 1.0, 0.2);   // Reddish object
+
+float maxCubeSideLength = 1.0;
+
+const int CONE_BLOCK_SIZE = 8; // Pixels per side of the blocks cone_march.glsl finds one start distance for
+
+// Where the traced ray hit trail, w is 1 once it has. Lets the renderers reproject the pixel
+vec4 rayHit = vec4(0.0);
+
+// Calculate the distance from a point to a cube centered at `c` with size `s`
+float distance_from_cube(in vec3 point, in vec3 center, in float sideLength) {
+    vec3 d = abs(point - center) - vec3(mix(0, maxCubeSideLength, sideLength) * 0.5f);
+    return length(max(d, 0.0)) + min(max(d.x, max(d.y, d.z)), 0.0);
+}
+
+float distance_from_sphere(in vec3 point, in vec3 center, in float radius) {
+    // Distance from center minus the sphere radius
+    return length(point - center) - radius;
+}
+
+float distance_from_rounded_cube(in vec3 point, in vec3 center, in float sideLength, float radius) {
+    // Compute the half-size of the cube
+    float halfSize = mix(0, maxCubeSideLength, sideLength) * 0.5;
+
+    // Distance to the surface of the box minus the rounding radius
+    vec3 d = abs(point - center) - vec3(halfSize - radius);
+    return length(max(d, 0.0)) - radius;
+}
+
+#ifdef TILED_VIEW
+// The grid repeats in every direction, so any voxel position maps back into it
+ivec3 tile_voxel(in ivec3 voxel) {
+    return ((voxel % settings.grid_size) + settings.grid_size) % settings.grid_size;
+}
+#endif
+
+float smooth_min(float a, float b, float k) {
+    float h = max(k - abs(a - b), 0.0) / k;
+    return min(a, b) - h * h * k * 0.25;
+}
+
+float smooth_max(float a, float b, float k) {
+    float h = max(k - abs(a - b), 0.0) / k;
+    return max(a, b) + h * h * k * 0.25;
+}
+
+// Distance to the trail cubes around the point, capped at the search radius so it is only exact near them
+float map_trail_cubes(in vec3 point) {
+    float result = 1e6; // Start with a very large value (infinite distance)
+    const int searchRadius = 1; // Local cube radius (adjustable)
+
+    // Convert point to grid coordinates
+    ivec3 center = ivec3(floor(point));
+
+    float cameraSDF = distance_from_sphere(point, settings.camera_position.xyz, float(settings.grid_size) / 4.0);
+
+    #ifdef TILED_VIEW
+    // Cubes across the seam come from the opposite face
+    ivec3 searchMin = center - searchRadius;
+    ivec3 searchMax = center + searchRadius;
+    #else
+    ivec3 searchMin = max(center - searchRadius, 0);
+    ivec3 searchMax = min(center + searchRadius, settings.grid_size - 1);
+    #endif
+
+    // Iterate only within a cube around the ray's current position
+    for (int x = searchMin.x; x <= searchMax.x; x++) {
+        for (int y = searchMin.y; y <= searchMax.y; y++) {
+            for (int z = searchMin.z; z <= searchMax.z; z++) {
+                #ifdef TILED_VIEW
+                ivec3 voxel = tile_voxel(ivec3(x,y,z));
+                #else
+                ivec3 voxel = ivec3(x,y,z);
+                #endif
+
+                float voxelValue = loadTrailVoxel(voxel);
+
+                // Skip zero-sized cubes
+                if (voxelValue <= 0.01) continue;
+
+                // Calculate the grid position
+                vec3 gridPoint = vec3(float(x), float(y), float(z));
+
+                // Calculate the distance to the cube at this grid point
+                float cube = distance_from_cube(point, gridPoint, voxelValue);
+
+                // Combine distances using smooth_min for blending
+                result = smooth_min(result, cube, 0.55);
+            }
+        }
+    }
+
+    // Moves search radius if nothing has been encountered.
+    result = min(searchRadius, result);
+    result = max(result, -cameraSDF);
+    return result; // Return the minimum distance for the scene
+}
+
+// Distance in voxels from the reduced SDF cell holding the point to its seed
+float sdf_distance(in vec3 point) {
+    // Convert point to grid coordinates
+    ivec3 center = ivec3(floor(point));
+
+    #ifdef TILED_VIEW
+    // The periodic SDF holds for every copy of the grid
+    ivec3 searchPoint = tile_voxel(center) / settings.sdf_reduction;
+    #else
+    // Clamped as a texel outside the SDF reads as a packed seed at the origin
+    ivec3 searchPoint = clamp(center / settings.sdf_reduction, ivec3(0), ivec3(sdfGridSize() - 1));
+    #endif
+    // The SDF may be a few frames old when its rebuild is amortized
+    return seedDistance(imageLoad(sdfData, searchPoint).x, searchPoint) - settings.sdf_margin;
+}
+
+// Distance the SDF alone lets the ray advance, or -1 close to trail where map_trail_cubes() has to be asked
+float sdf_step(in vec3 point) {
+    float result = 1e6; // Start with a very large value (infinite distance)
+    const int searchRadius = 1; // Local cube radius (adjustable)
+
+    int sdfReductionFactor = settings.sdf_reduction;
+
+    float sdfDistance = sdf_distance(point);
+
+    float cameraSDF = distance_from_sphere(point, settings.camera_position.xyz, float(settings.grid_size) / 4.0);
+
+    // skip this if the closest cube is less than the max betwen the search radius and the reduction factor times by the diagonal of the cube to make sure it will account for diagonal movement.
+    if (sdfDistance > max(sdfReductionFactor, searchRadius) * 1.8) {
+        // subtract a bit off to make sure we do not overshoot
+        result = sdfDistance - sdfReductionFactor / 2.0;
+        result = min(result, settings.grid_size / 2.0); // make sure it jumps no more than half the grid at one point to account for sdf values not set
+        result = max(result, -cameraSDF);
+        return result;
+    }
+
+    return -1.0;
+}
+
+float map_the_world(in vec3 point) {
+    float sdfStep = sdf_step(point);
+    if (sdfStep >= 0.0) {
+        return sdfStep;
+    }
+
+    return map_trail_cubes(point);
+}
+
+float map_the_world_transparent(in vec3 point) {
+    float result = 1e6; // Start with a very large value (infinite distance)
+
+    // The tiled view is opaque only, so the SDF is always read clamped here
+    float sdfDistance = sdf_distance(point);
+
+    float cameraSDF = distance_from_sphere(point, settings.camera_position.xyz, float(settings.grid_size) / 4.0);
+
+    result = sdfDistance;
+    result = max(result, -cameraSDF);
+    return result;
+}
+
+// Calculate the normal at a point on the surface, close enough to it that the SDF is never consulted
+vec3 calculate_normal(in vec3 point) {
+    const float EPSILON = 0.01;
+    float dx = map_trail_cubes(point + vec3(EPSILON, 0.0, 0.0)) - map_trail_cubes(point - vec3(EPSILON, 0.0, 0.0));
+    float dy = map_trail_cubes(point + vec3(0.0, EPSILON, 0.0)) - map_trail_cubes(point - vec3(0.0, EPSILON, 0.0));
+    float dz = map_trail_cubes(point + vec3(0.0, 0.0, EPSILON)) - map_trail_cubes(point - vec3(0.0, 0.0, EPSILON));
+    return normalize(vec3(dx, dy, dz));
+}
+
+vec3 calculage_lighting(in vec3 rayOrigin, in vec3 current_position) {
+    // Calculate normal at the hit point
+    vec3 normal = calculate_normal(current_position);
+    vec3 lightPosition = vec3(-5, settings.grid_size * 1.5f, -5); // Light above and slightly to the side
+
+    // Calculate lighting
+    vec3 lightDir = normalize(lightPosition - current_position); // Direction to light
+    float diff = max(dot(normal, lightDir), 0.0); // Lambertian (diffuse) term
+
+    // Calculate view direction
+    vec3 viewDir = normalize(rayOrigin - current_position);
+
+    // Combine light contributions
+    vec3 ambient = 0.1 * lightColor; // Ambient lighting
+    vec3 diffuse = diff * lightColor; // Diffuse lighting
+
+    vec3 light = diffuse + ambient ; // Combine all light components
+
+    #ifdef TILED_VIEW
+    // Every copy of the grid is coloured the same
+    vec3 gradient = mod(current_position, vec3(settings.grid_size)) / vec3(settings.grid_size);
+    #else
+    vec3 gradient = current_position / vec3(settings.grid_size);
+    #endif
+
+    return gradient; // Multiply by object color
+}
+
+// True once the ray has left the grid, which never happens in the tiled view
+bool left_grid(in vec3 point) {
+    #ifdef TILED_VIEW
+    return false;
+    #else
+    return distance_from_cube(point, settings.camera_focus.xyz, settings.grid_size) > 1;
+    #endif
+}
+
+// Perform ray marching to find intersections with the scene
+vec3 ray_march(in vec3 rayOrigin, in vec3 rayDirection) {
+    float total_distance_traveled = 0.0;
+    const int NUMBER_OF_STEPS = 500;
+    const float MINIMUM_HIT_DISTANCE = 0.1;
+    #ifdef TILED_VIEW
+    // A few copies of the grid deep, there are no bounds to leave
+    const float MAXIMUM_TRACE_DISTANCE = settings.grid_size * 4.0;
+    #else
+    // Diagonal of a cube side length * sqrt(3)
+    const float MAXIMUM_TRACE_DISTANCE = settings.grid_size * 1.732;
+    #endif
+
+    for (int i = 0; i < NUMBER_OF_STEPS; ++i) {
+        vec3 current_position = rayOrigin + total_distance_traveled * rayDirection;
+
+        // If traveled too far, or exited the bounds, return red (for now)
+        if (total_distance_traveled > MAXIMUM_TRACE_DISTANCE || left_grid(current_position)) {
+            return vec3(i / float(NUMBER_OF_STEPS), 0.0, 0.0);
+        }
+
+        float distance_to_closest = map_the_world(current_position);
+//        return vec3(distance_to_closest);
+
+        if (distance_to_closest < MINIMUM_HIT_DISTANCE) {
+            rayHit = vec4(current_position, 1.0);
+            return calculage_lighting(rayOrigin, current_position);
+        }
+
+        total_distance_traveled += distance_to_closest;
+    }
+    return vec3(0.0); // Background color (black)
+}
+
+#ifdef PYRAMID_MARCH
+// Below the cut-off map_trail_cubes() skips voxels at
+const float PYRAMID_EMPTY = 0.01;
+
+// Hierarchical DDA over the trail pyramid: jump across the coarsest empty cell around the ray, and only
+// sphere trace the trail cubes inside occupied level 0 cells. Needs no SDF, so no jump flood either
+vec3 ray_march_pyramid(in vec3 rayOrigin, in vec3 rayDirection) {
+    float total_distance_traveled = 0.0;
+    const int NUMBER_OF_STEPS = 500;
+    const float MINIMUM_HIT_DISTANCE = 0.1;
+    const float CELL_EXIT_BIAS = 0.01; // Lands the ray just inside the next cell
+    // Diagonal of a cube side length * sqrt(3)
+    const float MAXIMUM_TRACE_DISTANCE = settings.grid_size * 1.732;
+
+    int topLevel = textureQueryLevels(trailPyramid) - 1;
+    int level = topLevel;
+    vec3 inverseDirection = 1.0 / rayDirection;
+
+    for (int i = 0; i < NUMBER_OF_STEPS; ++i) {
+        vec3 current_position = rayOrigin + total_distance_traveled * rayDirection;
+
+        // If traveled too far, or exited the bounds, return red (for now)
+        if (total_distance_traveled > MAXIMUM_TRACE_DISTANCE || left_grid(current_position)) {
+            return vec3(i / float(NUMBER_OF_STEPS), 0.0, 0.0);
+        }
+
+        // Voxel cubes are centred on integer positions, so cells are offset by half a voxel to contain them
+        vec3 cellPosition = current_position + 0.5;
+        float cellSize = float(2 << level);
+        ivec3 cell = ivec3(floor(cellPosition / cellSize));
+
+        if (texelFetch(trailPyramid, cell, level).x <= PYRAMID_EMPTY) {
+            // Skip to where the ray leaves the empty cell
+            vec3 cellExit = (vec3(cell) + step(0.0, rayDirection)) * cellSize;
+            vec3 exitDistances = (cellExit - cellPosition) * inverseDirection;
+            total_distance_traveled += max(min(exitDistances.x, min(exitDistances.y, exitDistances.z)), 0.0) + CELL_EXIT_BIAS;
+
+            // Neighbouring space is likely empty as well
+            level = min(level + 1, topLevel);
+            continue;
+        }
+
+        if (level > 0) {
+            level--;
+            continue;
+        }
+
+        float distance_to_closest = map_trail_cubes(current_position);
+
+        if (distance_to_closest < MINIMUM_HIT_DISTANCE) {
+            rayHit = vec4(current_position, 1.0);
+            return calculage_lighting(rayOrigin, current_position);
+        }
+
+        total_distance_traveled += distance_to_closest;
+    }
+    return vec3(0.0); // Background color (black)
+}
+#endif
+
+vec3 ray_march_transparency(in vec3 rayOrigin, in vec3 rayDirection) {
+    float total_distance_traveled = 0.0;
+    const int NUMBER_OF_STEPS = settings.grid_size;
+    const float MINIMUM_HIT_DISTANCE = .1;
+    const float STEP_MARCH_DISTANCE = settings.sdf_reduction * 0.75;
+    // Diagonal of a cube side length * sqrt(3)
+    const float MAXIMUM_TRACE_DISTANCE = settings.grid_size * 1.732;
+
+    vec3 opacity_accumulator = vec3(0.0); // Initialize as a vec3 to accumulate color
+    float opacity_scaler = 15.0 / (float(settings.grid_size));
+
+    for (int i = 0; i < NUMBER_OF_STEPS; ++i) {
+        vec3 current_position = rayOrigin + total_distance_traveled * rayDirection;
+
+        float traveled_this_step = 0.0;
+
+        // If traveled too far, return red (for now)
+        if (total_distance_traveled > MAXIMUM_TRACE_DISTANCE) {
+            return vec3(i / float(NUMBER_OF_STEPS), 0.0, 0.0);
+        }
+
+        // If exited the bounds, or opacity is full, return accumulated color
+        if (left_grid(current_position) ||
+        max(opacity_accumulator.x, max(opacity_accumulator.y, opacity_accumulator.z)) >= 1.0f) {
+            return opacity_accumulator; // Return the accumulated color
+        }
+
+        float distance_to_closest = map_the_world_transparent(current_position);
+        traveled_this_step = distance_to_closest * 0.8;
+
+        if (distance_to_closest < MINIMUM_HIT_DISTANCE) {
+            ivec3 gridCoord = clamp(ivec3(floor(current_position)), ivec3(0), ivec3(settings.grid_size - 1)); // Convert to grid coordinates
+            int voxelIndex = gridCoord.x + settings.grid_size * (gridCoord.y + settings.grid_size * gridCoord.z);
+
+            // Calculate opacity and add white (vec3(1.0)) scaled by the voxel value
+            float opacity_amount = loadVoxel(gridCoord) * opacity_scaler;
+            opacity_accumulator += (current_position / float(settings.grid_size)) * opacity_amount;
+            if (rayHit.w == 0.0) {
+                rayHit = vec4(current_position, 1.0); // The front of the volume stands in for the pixel's depth
+            }
+
+            traveled_this_step = STEP_MARCH_DISTANCE;
+        }
+
+        total_distance_traveled += traveled_this_step;
+    }
+
+    return opacity_accumulator;
+}
+
+bool intersectsAABB(vec3 rayOrigin, vec3 rayDirection, vec3 gridMin, vec3 gridMax, out float tNear) {
+    vec3 tMin = (gridMin - rayOrigin) / rayDirection;
+    vec3 tMax = (gridMax - rayOrigin) / rayDirection;
+    vec3 t1 = min(tMin, tMax);
+    vec3 t2 = max(tMin, tMax);
+    tNear = max(max(t1.x, t1.y), t1.z);
+    float tFar = min(min(t2.x, t2.y), t2.z);
+    return tNear <= tFar && tFar >= 0.0;
+}
+
+// Ray through the pixel at uv in [-1, 1], starting where it enters the grid. False if it misses the grid
+bool camera_ray(in vec2 uv, out vec3 rayOrigin, out vec3 rayDirection) {
+    // Calculate camera orientation
+    vec3 forward = normalize(settings.camera_focus.xyz - settings.camera_position.xyz); // Forward direction
+    vec3 worldUp = vec3(0.0, 1.0, 0.0); // World up vector
+    vec3 right = normalize(cross(worldUp, forward)); // Right vector
+    vec3 up = cross(forward, right); // Up vector
+
+    // Adjust UV for non-square aspect ratio
+    vec2 adjustedUV = uv;
+    adjustedUV.x *= settings.aspect_ratio; // Scale the x-coordinate by the aspect ratio
+
+    // Ray origin and direction
+    rayOrigin = settings.camera_position.xyz;
+    rayDirection = normalize(adjustedUV.x * right + adjustedUV.y * up + forward); // Combine screen-space uv with camera orientation
+
+    #ifndef TILED_VIEW
+    vec3 gridMin = vec3(0.0);
+    vec3 gridMax = vec3(settings.grid_size - 1);
+    vec3 offset = vec3(0.5); // offset to account for cube thickness
+
+    float tNear;
+    // Cull rays that don't intersect the AABB
+    if (!intersectsAABB(rayOrigin, rayDirection, gridMin - offset, gridMax + offset, tNear)) {
+        return false;
+    }
+
+    // Advance the ray origin to the intersection point with the AABB
+    rayOrigin += rayDirection * max(tNear - 0.001, 0.0); // Ensure tNear is non-negative
+    #endif
+    return true;
+}
+
+vec3 trace_ray(in vec3 rayOrigin, in vec3 rayDirection) {
+    #ifdef USE_TRANSPARENCY
+    return ray_march_transparency(rayOrigin, rayDirection);
+    #elif defined(PYRAMID_MARCH)
+    return ray_march_pyramid(rayOrigin, rayDirection);
+    #else
+    return ray_march(rayOrigin, rayDirection);
+    #endif
+}
+
+// Distance from the camera to where the traced ray hit trail, negative if it did not
+float ray_hit_distance() {
+    return rayHit.w > 0.0 ? distance(settings.camera_position.xyz, rayHit.xyz) : -1.0;
+}
+
+#ifdef CONE_PREPASS
+// Starts the ray where cone_march.glsl found its block's cone to stay clear of trail, if that is past the grid bounds
+void skip_to_cone_distance(in ivec2 pixel, inout vec3 rayOrigin, in vec3 rayDirection) {
+    float coneDistance = imageLoad(coneDistances, pixel / CONE_BLOCK_SIZE).x;
+    if (coneDistance > dot(rayOrigin - settings.camera_position.xyz, rayDirection)) {
+        rayOrigin = settings.camera_position.xyz + rayDirection * coneDistance;
+    }
+}
+#endif
+
+#ifdef DEPTH_CACHE
+const float DEPTH_CACHE_MARGIN = 2.0; // Voxels rays start short of the closest hit reprojected from the last frame
+const int DEPTH_CACHE_MAX_WINDOW = 7; // Pixels per side of last frame's depths a ray searches, rays needing more start as usual
+const float DEPTH_CACHE_NEAR = 1.0; // Voxels from the camera the search starts at when rays start at the camera
+
+// Where the point was on last frame's depth cache, in pixels. False when it was behind the previous camera
+bool previous_depth_pixel(in vec3 point, out vec2 previousPixel) {
+    vec3 previousPosition = settings.previous_camera_position.xyz;
+    vec3 forward = normalize(settings.previous_camera_focus.xyz - previousPosition);
+    vec3 right = normalize(cross(vec3(0.0, 1.0, 0.0), forward));
+    vec3 up = cross(forward, right);
+
+    vec3 toPoint = point - previousPosition;
+    float depth = dot(toPoint, forward);
+    if (depth <= 0.0) {
+        return false;
+    }
+
+    vec2 previousUV = vec2(dot(toPoint, right) / settings.aspect_ratio, dot(toPoint, up)) / depth;
+    previousPixel = (previousUV * 0.5 + 0.5) * vec2(imageSize(previousDepth));
+    return true;
+}
+
+// Starts the ray close to where the last frame's rays hit trail, instead of at the grid bounds. Every point of the
+// ray the march can reach lands on the segment between where its first and last points were on last frame's screen,
+// so the pixels around that segment hold a ray that saw whatever this ray hits, or something in front of it. The
+// closest of their hits, less the camera movement, a spore step of trail growth and a margin, is where the ray can
+// start. A moving camera stretches the segment, past DEPTH_CACHE_MAX_WINDOW or off last frame's screen the ray stays
+// where it is, as it does when the pixel saw the background
+void skip_to_cached_depth(in ivec2 pixel, inout vec3 rayOrigin, in vec3 rayDirection) {
+    if (imageLoad(previousDepth, pixel).x < 0.0) {
+        return;
+    }
+
+    vec3 cameraPosition = settings.camera_position.xyz;
+    float startDistance = max(dot(rayOrigin - cameraPosition, rayDirection), DEPTH_CACHE_NEAR);
+    #ifdef TILED_VIEW
+    float endDistance = startDistance + settings.grid_size * 4.0;
+    #else
+    float endDistance = startDistance + settings.grid_size * 1.732 + 1.0;
+    #endif
+
+    vec2 firstPixel;
+    vec2 lastPixel;
+    if (!previous_depth_pixel(cameraPosition + rayDirection * startDistance, firstPixel) ||
+        !previous_depth_pixel(cameraPosition + rayDirection * endDistance, lastPixel)) {
+        return;
+    }
+
+    // A pixel of slack on each side, a pixel's depth is that of the ray through its centre
+    ivec2 windowStart = ivec2(floor(min(firstPixel, lastPixel))) - 1;
+    ivec2 windowEnd = ivec2(floor(max(firstPixel, lastPixel))) + 1;
+    if (any(greaterThanEqual(windowEnd - windowStart, ivec2(DEPTH_CACHE_MAX_WINDOW))) ||
+        any(lessThan(windowStart, ivec2(0))) || any(greaterThanEqual(windowEnd, imageSize(previousDepth)))) {
+        return;
+    }
+
+    float closestHit = -1.0;
+    for (int y = windowStart.y; y <= windowEnd.y; ++y) {
+        for (int x = windowStart.x; x <= windowEnd.x; ++x) {
+            float neighborDistance = imageLoad(previousDepth, ivec2(x, y)).x;
+            if (neighborDistance >= 0.0 && (closestHit < 0.0 || neighborDistance < closestHit)) {
+                closestHit = neighborDistance;
+            }
+        }
+    }
+    if (closestHit < 0.0) {
+        return;
+    }
+
+    float cachedStart = closestHit - distance(cameraPosition, settings.previous_camera_position.xyz) - settings.spore_speed * settings.delta_time - DEPTH_CACHE_MARGIN;
+    if (cachedStart > dot(rayOrigin - cameraPosition, rayDirection)) {
+        rayOrigin = cameraPosition + rayDirection * cachedStart;
+    }
+}
+#endif
@@ -0,0 +1,34 @@
+// SDF cells only store the reduced grid cell of their nearest seed, packed 10:10:10 into an r32ui texel.
+// The distance always follows from the seed, so it is recomputed instead of stored. Injected after the settings buffer.
+
+const uint NO_SEED = 0xFFFFFFFFu; // Never produced by packSeed(), its top two bits stay clear
+const float NO_SEED_DISTANCE = 1e6;
+
+uint packSeed(ivec3 seedCell) {
+    uvec3 seed = uvec3(seedCell);
+    return seed.x | (seed.y << 10) | (seed.z << 20);
+}
+
+// Reduced grid cells per side, rounded up so the last cell covers what is left when grid_size is not a multiple
+int sdfGridSize() {
+    return (settings.grid_size + settings.sdf_reduction - 1) / settings.sdf_reduction;
+}
+
+ivec3 unpackSeed(uint packedSeed) {
+    return ivec3(packedSeed & 0x3FFu, (packedSeed >> 10) & 0x3FFu, (packedSeed >> 20) & 0x3FFu);
+}
+
+// Distance in voxels from the reduced grid cell to its seed
+float seedDistance(uint packedSeed, ivec3 cell) {
+    if (packedSeed == NO_SEED) {
+        return NO_SEED_DISTANCE;
+    }
+
+    vec3 offset = vec3(abs(cell - unpackSeed(packedSeed)) * settings.sdf_reduction);
+    #ifdef WRAP_AROUND
+    // The grid is periodic, so the seed may be closer the other way around. Measured in voxels,
+    // as a partial last cell makes the period shorter than the reduced grid
+    offset = min(offset, vec3(settings.grid_size) - offset);
+    #endif
+    return length(offset);
+}
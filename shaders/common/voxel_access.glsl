@@ -0,0 +1,97 @@
+// Trail grid reads and writes, injected after voxelData and the settings buffer are declared.
+// With SPARSE_GRID, voxelData is a pool of bricks and brickTable maps every grid brick to its pool slot.
+// Bricks get a slot when a spore moves into them and give it back once they decay to zero.
+// With LAZY_DECAY, voxels also hold the time they were last written and decay as they are read.
+
+// Trail value of a voxel as stored in the grid
+float decodeVoxel(vec4 stored) {
+    #ifdef LAZY_DECAY
+    // Decay is linear, so subtracting it for the whole time since the write gives the same value the decay pass would
+    return max(0.0, stored.x - settings.decay_speed * (settings.simulation_time - stored.y));
+    #else
+    return stored.x;
+    #endif
+}
+
+vec4 encodeVoxel(float value) {
+    #ifdef LAZY_DECAY
+    return vec4(value, settings.simulation_time, 0.0, 0.0);
+    #else
+    return vec4(value);
+    #endif
+}
+
+#ifdef SPARSE_GRID
+const int SPARSE_BRICK_SIZE = 8; // Same bricks as brick_tracking.glsl
+
+const uint UNALLOCATED_BRICK = 0u;
+const uint ALLOCATING_BRICK = 0xFFFFFFFFu; // Claimed by an invocation that is still popping a slot
+
+// Pool slot + 1 of every grid brick
+layout(binding = 6, r32ui) uniform uimage3D brickTable;
+
+// Stack of the unused pool slots, read back every few frames to grow the pool before it runs out
+layout(std430, binding = 13) buffer BrickPoolBuffer {
+    int free_count;
+    int failed_allocations; // Bricks that found the pool empty since the last readback
+    uint free_slots[];
+} brickPool;
+
+bool isAllocated(uint entry) {
+    return entry != UNALLOCATED_BRICK && entry != ALLOCATING_BRICK;
+}
+
+ivec3 poolVoxel(uint entry, ivec3 location) {
+    uint slot = entry - 1u;
+    uint side = uint(settings.sparse_pool_side);
+    ivec3 poolBrick = ivec3(slot % side, (slot / side) % side, slot / (side * side));
+    return poolBrick * SPARSE_BRICK_SIZE + (location % SPARSE_BRICK_SIZE);
+}
+
+float loadVoxel(ivec3 location) {
+    uint entry = imageLoad(brickTable, location / SPARSE_BRICK_SIZE).x;
+    return isAllocated(entry) ? decodeVoxel(imageLoad(voxelData, poolVoxel(entry, location))) : 0.0;
+}
+
+// Writes into bricks without a slot are dropped, allocateBrick() has to run in an earlier dispatch
+void storeVoxel(ivec3 location, float value) {
+    uint entry = imageLoad(brickTable, location / SPARSE_BRICK_SIZE).x;
+    if (isAllocated(entry)) {
+        imageStore(voxelData, poolVoxel(entry, location), encodeVoxel(value));
+    }
+}
+
+// Only the invocation that wins the claim pops a slot, the brick stays empty and is counted if the pool ran out
+void allocateBrick(ivec3 brick) {
+    if (imageLoad(brickTable, brick).x != UNALLOCATED_BRICK ||
+        imageAtomicCompSwap(brickTable, brick, UNALLOCATED_BRICK, ALLOCATING_BRICK) != UNALLOCATED_BRICK) {
+        return;
+    }
+
+    int index = atomicAdd(brickPool.free_count, -1) - 1;
+    if (index < 0) {
+        atomicAdd(brickPool.free_count, 1);
+        atomicAdd(brickPool.failed_allocations, 1);
+        imageAtomicExchange(brickTable, brick, UNALLOCATED_BRICK);
+        return;
+    }
+    imageAtomicExchange(brickTable, brick, brickPool.free_slots[index] + 1u);
+}
+
+// The brick has to be all zero, so the slot can be handed out again without clearing it
+void releaseBrick(ivec3 brick) {
+    uint entry = imageAtomicExchange(brickTable, brick, UNALLOCATED_BRICK);
+    if (isAllocated(entry)) {
+        int index = atomicAdd(brickPool.free_count, 1);
+        brickPool.free_slots[index] = entry - 1u;
+    }
+}
+#else
+float loadVoxel(ivec3 location) {
+    return decodeVoxel(imageLoad(voxelData, location));
+}
+
+void storeVoxel(ivec3 location, float value) {
+    imageStore(voxelData, location, encodeVoxel(value));
+}
+#endif
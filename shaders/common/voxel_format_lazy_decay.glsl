@@ -0,0 +1,9 @@
+// Trail value and the simulation time it was written at, decayed when read instead of by a pass over the grid
+#define VOXEL_FORMAT rg32f
+
+#define LAZY_DECAY
+
+// Stored at full precision, the decay is applied on read
+float quantizeVoxel(float value, ivec3 location, int frameIndex) {
+    return value;
+}
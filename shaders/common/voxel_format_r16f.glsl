@@ -0,0 +1,23 @@
+// Half precision trail grid, half the bandwidth of r32f
+#define VOXEL_FORMAT r16f
+
+// Values below 1.0 are 2^-11 apart or less, but slow decay can still take off less than that in a frame. Rounded up
+// or down at random like the r8 format, with the odds that keep the expected value
+float quantizeVoxel(float value, ivec3 location, int frameIndex) {
+    if (value <= 0.0) {
+        return 0.0;
+    }
+
+    uint hash = uint(location.x) * 73856093u ^ uint(location.y) * 19349663u ^ uint(location.z) * 83492791u ^ uint(frameIndex) * 2654435761u;
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+
+    float noise = float(hash) / 4294967296.0;
+
+    // Spacing of the half floats around the value, 10 mantissa bits. Subnormals below 2^-14 share the smallest one
+    float spacing = exp2(max(floor(log2(value)), -14.0) - 10.0);
+    return floor(value / spacing + noise) * spacing;
+}
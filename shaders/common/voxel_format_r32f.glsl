@@ -0,0 +1,7 @@
+// Full precision trail grid
+#define VOXEL_FORMAT r32f
+
+// Decay steps are always representable, nothing to round
+float quantizeVoxel(float value, ivec3 location, int frameIndex) {
+    return value;
+}
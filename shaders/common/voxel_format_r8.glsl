@@ -0,0 +1,18 @@
+// 8 bit unorm trail grid, a quarter of the bandwidth of r32f
+#define VOXEL_FORMAT r8
+
+const float VOXEL_LEVELS = 255.0;
+
+// A frame of decay is often less than one level, so round up or down at random
+// with the odds that keep the expected value. Plain rounding would stop slow decay entirely.
+float quantizeVoxel(float value, ivec3 location, int frameIndex) {
+    uint hash = uint(location.x) * 73856093u ^ uint(location.y) * 19349663u ^ uint(location.z) * 83492791u ^ uint(frameIndex) * 2654435761u;
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+
+    float noise = float(hash) / 4294967296.0;
+    return min(floor(value * VOXEL_LEVELS + noise), VOXEL_LEVELS) / VOXEL_LEVELS;
+}
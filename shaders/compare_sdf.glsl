@@ -0,0 +1,77 @@
+#version 430
+
+#define WRAP_AROUND
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define SDF_SEED
+
+layout(r32ui, binding = 1) uniform readonly uimage3D sdfData;          // SDF being checked
+layout(r32ui, binding = 2) uniform readonly uimage3D referenceSDFData; // Built by the full 26 neighbour jump flood
+
+struct SDFError {
+    float error_sum;  // Summed distance error of the cells both SDFs reached
+    float max_error;
+    uint mismatches;  // Cells whose distance differs, or that only one of the SDFs reached
+};
+
+// One entry per workgroup, summed on the CPU
+layout(std430, binding = 14) buffer SDFErrorBuffer {
+    SDFError workgroupErrors[];
+};
+
+const float MISMATCH_TOLERANCE = 1e-3;
+
+shared float errorSums[gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z];
+shared float maxErrors[gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z];
+shared uint mismatchCounts[gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z];
+
+void main() {
+    ivec3 reducedGridPos = ivec3(gl_GlobalInvocationID.xyz);
+    int reducedGridSize = sdfGridSize();
+    uint localIndex = gl_LocalInvocationIndex;
+
+    float error = 0.0;
+    uint mismatch = 0u;
+
+    // No early return, every invocation takes part in the reduction
+    if (all(lessThan(reducedGridPos, ivec3(reducedGridSize)))) {
+        float distance = seedDistance(imageLoad(sdfData, reducedGridPos).x, reducedGridPos);
+        float referenceDistance = seedDistance(imageLoad(referenceSDFData, reducedGridPos).x, reducedGridPos);
+
+        bool reached = distance < NO_SEED_DISTANCE;
+        bool referenceReached = referenceDistance < NO_SEED_DISTANCE;
+        if (reached && referenceReached) {
+            error = abs(distance - referenceDistance);
+        }
+        if (reached != referenceReached || error > MISMATCH_TOLERANCE) {
+            mismatch = 1u;
+        }
+    }
+
+    errorSums[localIndex] = error;
+    maxErrors[localIndex] = error;
+    mismatchCounts[localIndex] = mismatch;
+    barrier();
+
+    for (uint stride = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z / 2u; stride > 0u; stride /= 2u) {
+        if (localIndex < stride) {
+            errorSums[localIndex] += errorSums[localIndex + stride];
+            maxErrors[localIndex] = max(maxErrors[localIndex], maxErrors[localIndex + stride]);
+            mismatchCounts[localIndex] += mismatchCounts[localIndex + stride];
+        }
+        barrier();
+    }
+
+    if (localIndex == 0u) {
+        uint workgroupIndex = gl_WorkGroupID.x + gl_NumWorkGroups.x * (gl_WorkGroupID.y + gl_NumWorkGroups.y * gl_WorkGroupID.z);
+        workgroupErrors[workgroupIndex] = SDFError(errorSums[0], maxErrors[0], mismatchCounts[0]);
+    }
+}
@@ -0,0 +1,103 @@
+#version 430
+
+#define PYRAMID_MARCH
+
+#define SPARSE_GRID
+
+#define WRAP_AROUND
+
+#define TILED_VIEW
+
+// One invocation per 8x8 pixel block of the ray march that follows
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
+#define SDF_SEED
+
+layout(r32ui, binding = 1) uniform readonly uimage3D sdfData;
+
+#ifdef PYRAMID_MARCH
+// Max of the trail grid over 2^(level + 1) voxel cells, built by build_pyramid.glsl
+layout(binding = 8) uniform sampler3D trailPyramid;
+#endif
+
+// Distance from the camera every ray of the block can skip, read by skip_to_cone_distance()
+layout(r32f, binding = 2) uniform writeonly image2D coneDistances;
+
+uniform vec2 renderSize; // Resolution of the ray march the blocks divide
+
+// Only the SDF is marched here, the cube search is never reached
+float loadTrailVoxel(ivec3 voxel) {
+    return mayBeOccupied(voxel) ? loadVoxel(voxel) : 0.0;
+}
+
+#define RAY_MARCH
+
+const int NUMBER_OF_STEPS = 64;
+const float MINIMUM_CONE_STEP = 0.5; // Voxels, clearances below it mean the cone is about to touch trail
+
+// Distance from the point to the closest trail it could be near, never more than the real one. The SDF cell and the
+// cell of its seed are each up to a cell diagonal from the points they stand for, and cubes reach half a voxel out
+float safe_distance(in vec3 point) {
+    float cellSlack = 2.0 * 1.732 * float(settings.sdf_reduction) + 1.0;
+    #ifdef TILED_VIEW
+    return sdf_distance(point) - cellSlack;
+    #else
+    // There is no trail outside the grid, and the SDF is only known inside it
+    vec3 gridPoint = clamp(point, vec3(0.0), vec3(settings.grid_size - 1));
+    float gridDistance = distance_from_cube(point, settings.camera_focus.xyz, float(settings.grid_size)) - 1.0;
+    return max(gridDistance, sdf_distance(gridPoint) - cellSlack - distance(point, gridPoint));
+    #endif
+}
+
+void main() {
+    ivec2 block = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(block, imageSize(coneDistances)))) {
+        return;
+    }
+
+    // The cone's axis goes through the centre of the block, from the camera rather than where it enters the grid
+    vec2 uv = (vec2(block * CONE_BLOCK_SIZE) + float(CONE_BLOCK_SIZE) * 0.5) / renderSize * 2.0 - 1.0;
+    vec3 axisOrigin;
+    vec3 axisDirection;
+    camera_ray(uv, axisOrigin, axisDirection);
+
+    // Pixels are 2 / height apart on the view plane at distance 1, and their rays are at most that far apart at the
+    // same distance along them. The cone widens by a bit more than half the block's diagonal to hold all of them
+    float coneSlope = float(CONE_BLOCK_SIZE) * 0.75 * 2.0 / renderSize.y;
+
+    vec3 cameraPosition = settings.camera_position.xyz;
+    #ifdef TILED_VIEW
+    float maximumDistance = settings.grid_size * 4.0;
+    #else
+    float maximumDistance = distance(cameraPosition, settings.camera_focus.xyz) + settings.grid_size * 0.866;
+    #endif
+
+    float coneDistance = 0.0;
+    for (int i = 0; i < NUMBER_OF_STEPS && coneDistance < maximumDistance; ++i) {
+        float clearance = safe_distance(cameraPosition + axisDirection * coneDistance) - coneDistance * coneSlope;
+        if (clearance < MINIMUM_CONE_STEP) {
+            break;
+        }
+
+        // Every ray of the block stays inside the ball the safe distance leaves free for this much further
+        coneDistance += clearance / (1.0 + coneSlope);
+    }
+
+    imageStore(coneDistances, block, vec4(min(coneDistance, maximumDistance)));
+}
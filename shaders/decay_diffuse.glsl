@@ -0,0 +1,142 @@
+#version 430
+
+#define WRAP_AROUND
+
+#define SEPARABLE_DIFFUSION
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform readonly image3D voxelData;
+layout(binding = 4, VOXEL_FORMAT) uniform writeonly image3D diffusedVoxelData; // Swapped with voxelData after the pass
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define BRICK_TRACKING
+
+// Every voxel of the tile is rewritten, so its occupancy words are rebuilt rather than updated
+#define TILE_OCCUPANCY
+
+#define OCCUPANCY
+
+const int TILE_SIZE = 8;
+const int HALO_TILE_SIZE = TILE_SIZE + 2; // One voxel of halo on each side
+const int TILE_VOLUME = TILE_SIZE * TILE_SIZE * TILE_SIZE;
+const int HALO_TILE_VOLUME = HALO_TILE_SIZE * HALO_TILE_SIZE * HALO_TILE_SIZE;
+
+// Every voxel of the tile and its halo is read from the grid exactly once
+shared float tile[HALO_TILE_VOLUME];
+
+// Tiles line up with bricks, so the tile decides if its brick stays listed
+shared bool brickOccupied;
+
+#ifdef SEPARABLE_DIFFUSION
+// Intermediate results of the per-axis passes, each one drops the halo of the axis it blurred
+shared float blurredX[TILE_SIZE * HALO_TILE_SIZE * HALO_TILE_SIZE];
+shared float blurredXY[TILE_SIZE * TILE_SIZE * HALO_TILE_SIZE];
+
+// [1 2 1] / 4 along each axis
+const float KERNEL_EDGE = 0.25;
+const float KERNEL_CENTER = 0.5;
+#endif
+
+int tileIndex(ivec3 p) {
+    return p.x + HALO_TILE_SIZE * (p.y + HALO_TILE_SIZE * p.z);
+}
+
+ivec3 boundaryVoxel(ivec3 p, int gridSize) {
+    #ifdef WRAP_AROUND
+    // Halo wraps to the opposite face
+    return (p + gridSize) % gridSize;
+    #else
+    // Replicate the edge voxels
+    return clamp(p, ivec3(0), ivec3(gridSize - 1));
+    #endif
+}
+
+void main() {
+    int gridSize = settings.grid_size;
+    ivec3 tileOrigin = ivec3(gl_WorkGroupID.xyz) * TILE_SIZE - 1;
+    ivec3 local = ivec3(gl_LocalInvocationID.xyz);
+    int localIndex = int(gl_LocalInvocationIndex);
+
+    if (localIndex == 0) {
+        brickOccupied = false;
+    }
+    clearTileOccupancy();
+
+    // Cooperative load of the tile plus halo
+    for (int i = localIndex; i < HALO_TILE_VOLUME; i += TILE_VOLUME) {
+        ivec3 p = ivec3(i % HALO_TILE_SIZE, (i / HALO_TILE_SIZE) % HALO_TILE_SIZE, i / (HALO_TILE_SIZE * HALO_TILE_SIZE));
+        tile[i] = imageLoad(voxelData, boundaryVoxel(tileOrigin + p, gridSize)).x;
+    }
+    barrier();
+
+    #ifdef SEPARABLE_DIFFUSION
+    for (int i = localIndex; i < TILE_SIZE * HALO_TILE_SIZE * HALO_TILE_SIZE; i += TILE_VOLUME) {
+        ivec3 p = ivec3(i % TILE_SIZE, (i / TILE_SIZE) % HALO_TILE_SIZE, i / (TILE_SIZE * HALO_TILE_SIZE));
+        blurredX[i] = KERNEL_EDGE * tile[tileIndex(p)]
+                    + KERNEL_CENTER * tile[tileIndex(p + ivec3(1, 0, 0))]
+                    + KERNEL_EDGE * tile[tileIndex(p + ivec3(2, 0, 0))];
+    }
+    barrier();
+
+    for (int i = localIndex; i < TILE_SIZE * TILE_SIZE * HALO_TILE_SIZE; i += TILE_VOLUME) {
+        ivec3 p = ivec3(i % TILE_SIZE, (i / TILE_SIZE) % TILE_SIZE, i / (TILE_SIZE * TILE_SIZE));
+        int row = p.x + TILE_SIZE * (p.y + HALO_TILE_SIZE * p.z);
+        blurredXY[i] = KERNEL_EDGE * blurredX[row]
+                     + KERNEL_CENTER * blurredX[row + TILE_SIZE]
+                     + KERNEL_EDGE * blurredX[row + 2 * TILE_SIZE];
+    }
+    barrier();
+
+    int column = local.x + TILE_SIZE * (local.y + TILE_SIZE * local.z);
+    float blurred = KERNEL_EDGE * blurredXY[column]
+                  + KERNEL_CENTER * blurredXY[column + TILE_SIZE * TILE_SIZE]
+                  + KERNEL_EDGE * blurredXY[column + 2 * TILE_SIZE * TILE_SIZE];
+    #else
+    // 3x3x3 box average straight out of shared memory
+    float blurred = 0.0;
+    for (int z = 0; z < 3; ++z) {
+        for (int y = 0; y < 3; ++y) {
+            for (int x = 0; x < 3; ++x) {
+                blurred += tile[tileIndex(local + ivec3(x, y, z))];
+            }
+        }
+    }
+    blurred /= 27.0;
+    #endif
+
+    // Only bounds check after the barriers, every invocation has to help fill the tile
+    ivec3 location = ivec3(gl_GlobalInvocationID.xyz);
+    if (all(lessThan(location, ivec3(gridSize)))) {
+        float original = tile[tileIndex(local + 1)];
+        float diffuseWeight = clamp(settings.diffuse_speed * settings.delta_time, 0.0, 1.0);
+
+        float voxelValue = mix(original, blurred, diffuseWeight);
+        voxelValue = max(0.0, voxelValue - settings.decay_speed * settings.delta_time);
+        voxelValue = quantizeVoxel(voxelValue, location, settings.frame_index);
+        imageStore(diffusedVoxelData, location, vec4(voxelValue));
+
+        if (voxelValue > 0.0) {
+            brickOccupied = true;
+            markTileOccupied(location);
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    storeTileOccupancy(ivec3(gl_WorkGroupID.xyz) * TILE_SIZE);
+
+    // Diffusion can spread trail into bricks that were empty, so list every occupied one
+    if (localIndex == 0 && brickOccupied) {
+        activateBrick(ivec3(gl_WorkGroupID.xyz));
+    }
+}
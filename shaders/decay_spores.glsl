@@ -1,30 +1,77 @@
 #version 430
 
+#define SPARSE_GRID
 
 // Simulation Settings
 #define SIMULATION_SETTINGS
 
+// Dispatched indirectly, one workgroup per active brick
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
-layout(binding = 0, r32f) uniform image3D voxelData;
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
 
 layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
+#define BRICK_TRACKING
+
+#define VOXEL_ACCESS
+
+// The whole brick is rewritten, so its occupancy words are rebuilt rather than updated
+#define TILE_OCCUPANCY
+
+#define OCCUPANCY
+
+shared bool brickOccupied;
+
 
 void main() {
-    // Get the 3D indices of the current work item
-    uint x = gl_GlobalInvocationID.x;
-    uint y = gl_GlobalInvocationID.y;
-    uint z = gl_GlobalInvocationID.z;
+    uint brickSlot = activeBrickSlot();
 
-    // Ensure the indices are within the bounds of the grid
-    if (x >= uint(settings.grid_size) || y >= uint(settings.grid_size) || z >= uint(settings.grid_size)) {
+    // The whole workgroup leaves together, so the barriers below stay uniform
+    if (brickSlot >= activeBricks.brick_count) {
         return;
     }
 
-    ivec3 location = ivec3(x,y,z);
-    float voxelValue = max(0.0, imageLoad(voxelData, location).x - settings.decay_speed * settings.delta_time);
-    imageStore(voxelData, location, vec4(voxelValue));
+    if (gl_LocalInvocationIndex == 0) {
+        brickOccupied = false;
+    }
+    clearTileOccupancy();
+    memoryBarrierShared();
+    barrier();
+
+    ivec3 brick = unpackBrick(activeBricks.bricks[brickSlot]);
+    ivec3 location = brick * BRICK_SIZE + ivec3(gl_LocalInvocationID.xyz);
+
+    // Ensure the indices are within the bounds of the grid
+    if (all(lessThan(location, ivec3(settings.grid_size)))) {
+        float voxelValue = max(0.0, loadVoxel(location) - settings.decay_speed * settings.delta_time);
+        voxelValue = quantizeVoxel(voxelValue, location, settings.frame_index);
+        storeVoxel(location, voxelValue);
+
+        if (voxelValue > 0.0) {
+            brickOccupied = true;
+            markTileOccupied(location);
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    storeTileOccupancy(brick * BRICK_SIZE);
+
+    // Bricks that fully decayed drop out of the list
+    if (gl_LocalInvocationIndex == 0 && brickOccupied) {
+        activateBrick(brick);
+    }
+
+    #ifdef SPARSE_GRID
+    // And hand their pool slot back
+    if (gl_LocalInvocationIndex == 0 && !brickOccupied) {
+        releaseBrick(brick);
+    }
+    #endif
 }
@@ -1,5 +1,9 @@
 #version 430
 
+#define ATOMIC_DEPOSIT
+
+#define SPARSE_GRID
+
 #define SPORE_STRUCT
 
 // Simulation Settings
@@ -7,20 +11,37 @@
 
 layout(local_size_x = 8, local_size_y = 1, local_size_z = 1) in;
 
-layout(binding = 0, r32f) uniform image3D voxelData;
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+#ifdef ATOMIC_DEPOSIT
+// Fixed-point trail accumulator, folded into voxelData by resolve_deposits.glsl
+layout(binding = 3, r32ui) uniform uimage3D depositData;
+
+const float DEPOSIT_FIXED_POINT_SCALE = 65536.0;
+#endif
 
 // Buffers
-layout(std430, binding = 0) buffer SporesBuffer {
-    Spore spores[];
+layout(std430, binding = 0) buffer SporePositionsBuffer {
+    SporePosition sporePositions[];
 };
 
 layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
+#define BRICK_TRACKING
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
+#define LINEAR_DISPATCH
 
 void main() {
-    uint sporeID = gl_GlobalInvocationID.x;
+    uint sporeID = linearInvocationID();
 
     // Check bounds
     if (sporeID >= settings.spore_count) {
@@ -30,7 +51,8 @@ void main() {
     int gridSize = settings.grid_size;
 
     // Get the spore position
-    vec3 sporePosition = spores[sporeID].position.xyz;
+    SporePosition position = sporePositions[sporeID];
+    vec3 sporePosition = vec3(position.x, position.y, position.z);
 
     // Determine the voxel grid coordinates closest to the spore position
     ivec3 voxelCoord = ivec3(
@@ -40,5 +62,13 @@ void main() {
     );
 
 
-    imageStore(voxelData, voxelCoord, vec4(1.0)); // Mark the voxel as occupied by the spore
+    activateVoxelBrick(voxelCoord);
+
+    #ifdef ATOMIC_DEPOSIT
+    imageAtomicAdd(depositData, voxelCoord, uint(settings.deposit_amount * DEPOSIT_FIXED_POINT_SCALE));
+    #else
+    storeVoxel(voxelCoord, 1.0); // Mark the voxel as occupied by the spore
+    #endif
+
+    markOccupied(voxelCoord);
 }
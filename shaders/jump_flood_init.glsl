@@ -1,5 +1,9 @@
 #version 430
 
+#define TEMPORAL_JFA
+
+#define SPARSE_GRID
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
 // Simulation Settings
@@ -10,27 +14,28 @@ layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
-layout(binding = 0, r32f) uniform image3D voxelData;
+// Trail grid format
+#define VOXEL_FORMAT
 
-// Using image3D for SDF data
-layout(rgba32f, binding = 1) uniform writeonly image3D sdfData;
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
 
+#define VOXEL_ACCESS
 
-void main() {
-    // Calculate 3D position in the reduced grid
-    ivec3 reducedGridPos = ivec3(gl_GlobalInvocationID.xyz);
+#define OCCUPANCY
 
-    int sdfReductionFactor = settings.sdf_reduction;
+#define SDF_SEED
 
-    // Compute 1D index for the reduced grid
-    int reducedGridSize = settings.grid_size / sdfReductionFactor;
-    int reducedIndex = reducedGridPos.x + reducedGridSize * (reducedGridPos.y + reducedGridSize * reducedGridPos.z);
+#ifdef TEMPORAL_JFA
+// Last frame's finished SDF, its seeds are reused where their trail is still there
+layout(r32ui, binding = 1) uniform readonly uimage3D previousSDFData;
+#endif
+
+// Packed seed of every reduced grid cell
+layout(r32ui, binding = 2) uniform writeonly uimage3D sdfData;
 
-    // Early exit if we're outside the valid range
-    if (any(greaterThanEqual(reducedGridPos, ivec3(reducedGridSize)))) {
-        return;
-    }
 
+// True if any high resolution voxel covered by the reduced grid cell holds trail
+bool cellOccupied(ivec3 reducedGridPos, int sdfReductionFactor) {
     // Determine the corresponding high-resolution area to search
     ivec3 highGridStart = reducedGridPos * sdfReductionFactor;
     ivec3 highGridEnd = highGridStart + (sdfReductionFactor - 1);
@@ -38,36 +43,65 @@ void main() {
     highGridStart = clamp(highGridStart, ivec3(0), ivec3(settings.grid_size - 1));
     highGridEnd = clamp(highGridEnd, ivec3(0), ivec3(settings.grid_size - 1));
 
+    // Walk the occupancy words covering the area, most of them are empty and answer for 32 voxels at once
+    ivec3 wordStart = occupancyWord(highGridStart);
+    ivec3 wordEnd = occupancyWord(highGridEnd);
+    for (int wz = wordStart.z; wz <= wordEnd.z; ++wz) {
+        for (int wy = wordStart.y; wy <= wordEnd.y; ++wy) {
+            for (int wx = wordStart.x; wx <= wordEnd.x; ++wx) {
+                ivec3 word = ivec3(wx, wy, wz);
+                uint occupancy = imageLoad(occupancyData, word).x;
+                if (occupancy == 0u) {
+                    continue;
+                }
 
-
-    // Initialize the SDF cell with "infinite" distance
-    vec4 sdfEntry = vec4(reducedGridPos * sdfReductionFactor, 1e6);
-
-    // Search within the corresponding high-resolution area
-    for (int z = highGridStart.z; z <= highGridEnd.z; ++z) {
-        for (int y = highGridStart.y; y <= highGridEnd.y; ++y) {
-            for (int x = highGridStart.x; x <= highGridEnd.x; ++x) {
-                // Compute 1D index for the high-resolution voxel grid
-                int highIndex = x + settings.grid_size * (y + settings.grid_size * z);
-
-                // Check if the voxel is filled
-                if (imageLoad(voxelData, ivec3(x,y,z)).x > 0.0) {
-
-                    // Mark the reduced grid cell as having a value
-                    sdfEntry = vec4(reducedGridPos * sdfReductionFactor, 0.0);
-                    break; // Exit the loop early if any voxel is filled
+                // Set bits may be stale, so confirm them against the grid, exiting as soon as any voxel is filled
+                ivec3 first = max(word * OCCUPANCY_WORD_SIZE, highGridStart);
+                ivec3 last = min(word * OCCUPANCY_WORD_SIZE + OCCUPANCY_WORD_SIZE - 1, highGridEnd);
+                for (int z = first.z; z <= last.z; ++z) {
+                    for (int y = first.y; y <= last.y; ++y) {
+                        for (int x = first.x; x <= last.x; ++x) {
+                            ivec3 location = ivec3(x, y, z);
+                            if ((occupancy & occupancyBit(location)) != 0u && loadVoxel(location) > 0.0) {
+                                return true;
+                            }
+                        }
+                    }
                 }
             }
-            if (sdfEntry.w == 0.0) break; // Exit the outer loop early
         }
-        if (sdfEntry.w == 0.0) break; // Exit the outer loop early
+    }
+    return false;
+}
+
+void main() {
+    // Calculate 3D position in the reduced grid
+    ivec3 reducedGridPos = ivec3(gl_GlobalInvocationID.xyz);
+
+    int sdfReductionFactor = settings.sdf_reduction;
+    int reducedGridSize = sdfGridSize();
+
+    // Early exit if we're outside the valid range
+    if (any(greaterThanEqual(reducedGridPos, ivec3(reducedGridSize)))) {
+        return;
     }
 
-    // TODO: Remove, this is for testing
-//    if (reducedGridPos == ivec3(9, 9, 9)) {
-//        sdfEntry = vec4(reducedGridPos * sdfReductionFactor, 0.0); // Ensure (0, 0, 0) is defaulted if needed
-//    }
+    // Initialize the SDF cell with "infinite" distance
+    uint sdfEntry = NO_SEED;
+
+    if (cellOccupied(reducedGridPos, sdfReductionFactor)) {
+        // Mark the reduced grid cell as its own seed
+        sdfEntry = packSeed(reducedGridPos);
+    }
+    #ifdef TEMPORAL_JFA
+    else {
+        // Seeds are kept even once their trail decayed, a cell reset to NO_SEED may be further than the few step passes
+        // reach and would read as empty space. The seed was the nearest trail last frame, so the trail that is left is
+        // at least as far and the distance stays a lower bound. Marches only slow down near it until the next full rebuild
+        sdfEntry = imageLoad(previousSDFData, reducedGridPos).x;
+    }
+    #endif
 
     // Write the result to the reduced SDF grid
-    imageStore(sdfData, reducedGridPos, sdfEntry);
+    imageStore(sdfData, reducedGridPos, uvec4(sdfEntry));
 }
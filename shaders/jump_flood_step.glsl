@@ -1,5 +1,9 @@
 #version 430
 
+#define SEPARABLE_JFA
+
+#define WRAP_AROUND
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
 // Simulation Settings
@@ -10,40 +14,51 @@ layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
-layout(rgba32f, binding = 1) uniform readonly image3D readSDFData; // just updated to using textures instead of an array buffer
-layout(rgba32f, binding = 2) uniform writeonly image3D writeSDFData;
+#define SDF_SEED
+
+layout(r32ui, binding = 1) uniform readonly uimage3D readSDFData; // Packed seeds, see sdf_seed.glsl
+layout(r32ui, binding = 2) uniform writeonly uimage3D writeSDFData;
 
 
 
 uniform int stepSize;
 
+#ifdef SEPARABLE_JFA
+// 0, 1 or 2. All steps run along x, then y, then z, like a separable distance transform:
+// after the x passes every cell knows the nearest seed in its row, after y in its plane
+uniform int stepAxis;
+#endif
+
 void main() {
     // Calculate 3D grid position from global invocation ID
     ivec3 reducedGridPos = ivec3(gl_GlobalInvocationID.xyz);
 
-    int sdfReductionFactor = settings.sdf_reduction;
-    int gridSize = settings.grid_size / sdfReductionFactor;
+    int gridSize = sdfGridSize();
     
     // Early exit if we're outside the valid range
     if (any(greaterThanEqual(reducedGridPos, ivec3(gridSize)))) {
         return;
     }
 
-    vec3 worldGridPos = vec3(reducedGridPos * sdfReductionFactor);
-
-
-    // Read the current value from the readSDFData texture
-    vec4 currentValue = imageLoad(readSDFData, reducedGridPos);
+    // Read the current seed from the readSDFData texture
+    uint currentSeed = imageLoad(readSDFData, reducedGridPos).x;
 
     // Initialize the output with the current value
-    vec4 outputValue = currentValue;
+    uint outputSeed = currentSeed;
+    float outputDistance = seedDistance(currentSeed, reducedGridPos);
 
-    // Skip if this cell already has w == 0.0 (it's a seed point)
-    if (currentValue.w <= 0.0) {
-        imageStore(writeSDFData, reducedGridPos, outputValue);
+    // Skip if this cell is its own seed
+    if (outputDistance <= 0.0) {
+        imageStore(writeSDFData, reducedGridPos, uvec4(outputSeed));
         return;
     }
 
+    #ifdef SEPARABLE_JFA
+    // Only the two neighbours along the axis
+    ivec3 axisOffset = ivec3(0);
+    axisOffset[stepAxis] = 1;
+    ivec3 neighborOffsets[] = ivec3[](-axisOffset, axisOffset);
+    #else
     // Define the relative neighbor positions based on stepSize
     ivec3 neighborOffsets[] = ivec3[](
     // Direct neighbors (faces)
@@ -78,34 +93,36 @@ void main() {
     ivec3(1, 1, -1),
     ivec3(1, 1, 1)
     );
+    #endif
 
 
     // Iterate through all neighbors
     for (int i = 0; i < neighborOffsets.length(); ++i) {
         ivec3 neighborPos = reducedGridPos + neighborOffsets[i] * stepSize;
+        #ifdef WRAP_AROUND
+        // Seeds flood across the faces like spores move across them
+        neighborPos = (neighborPos + gridSize) % gridSize;
+        #else
         neighborPos = clamp(neighborPos, ivec3(0), ivec3(gridSize - 1)); // Ensure within bounds
+        #endif
 
-        // Load the neighbor's value from the readSDFData texture
-        vec4 neighborValue = imageLoad(readSDFData, neighborPos);
+        // Load the neighbor's seed from the readSDFData texture
+        uint neighborSeed = imageLoad(readSDFData, neighborPos).x;
 
         // Skip invalid neighbors
-        if (neighborValue.w >= 1e6) {
+        if (neighborSeed == NO_SEED) {
             continue;
         }
 
         // Calculate the distance to the seed from this neighbor
-        float distance = length(worldGridPos - neighborValue.xyz);
+        float distance = seedDistance(neighborSeed, reducedGridPos);
 
         // Update the current cell if the neighbor provides a closer seed
-        if (distance < outputValue.w) {
-            outputValue = vec4(neighborValue.xyz, distance);
+        if (distance < outputDistance) {
+            outputSeed = neighborSeed;
+            outputDistance = distance;
         }
     }
 
-    // Ensure we always write a valid value
-    if (outputValue.w >= 1e6) {
-        outputValue = vec4(worldGridPos, 1e6); // Use current position as reference if no valid neighbor found
-    }
-
-    imageStore(writeSDFData, reducedGridPos, outputValue);
+    imageStore(writeSDFData, reducedGridPos, uvec4(outputSeed));
 }
@@ -0,0 +1,53 @@
+#version 430
+
+#define SPORE_STRUCT
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// Buffers
+layout(std430, binding = 0) buffer SporePositionsBuffer {
+    SporePosition sporePositions[];
+};
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+layout(std430, binding = 5) buffer SortKeysBuffer {
+    uint sortKeys[];
+};
+
+layout(std430, binding = 6) buffer SortValuesBuffer {
+    uint sortValues[];
+};
+
+#define LINEAR_DISPATCH
+
+// Spreads the lower 10 bits out so there are two zero bits between each
+uint expandBits(uint v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+void main() {
+    uint sporeID = linearInvocationID();
+
+    // Check bounds
+    if (sporeID >= settings.spore_count) {
+        return;
+    }
+
+    // Quantize the position to 10 bits per axis, whatever the grid size
+    SporePosition position = sporePositions[sporeID];
+    vec3 normalizedPosition = vec3(position.x, position.y, position.z) / float(settings.grid_size);
+    uvec3 cell = uvec3(clamp(normalizedPosition * 1024.0, vec3(0.0), vec3(1023.0)));
+
+    sortKeys[sporeID] = expandBits(cell.x) | (expandBits(cell.y) << 1) | (expandBits(cell.z) << 2);
+    sortValues[sporeID] = sporeID;
+}
@@ -2,6 +2,12 @@
 
 #define WRAP_AROUND
 
+#define FUSED_DEPOSIT
+
+#define ATOMIC_DEPOSIT
+
+#define SPARSE_GRID
+
 #define SPORE_STRUCT
 
 // Simulation Settings
@@ -10,15 +16,37 @@
 layout(local_size_x = 8, local_size_y = 1, local_size_z = 1) in;
 
 // Buffers
-layout(std430, binding = 0) buffer SporesBuffer {
-    Spore spores[];
+layout(std430, binding = 0) buffer SporePositionsBuffer {
+    SporePosition sporePositions[];
+};
+
+layout(std430, binding = 11) buffer SporeOrientationsBuffer {
+    SporeOrientation sporeOrientations[];
 };
 
 layout(std430, binding = 1) buffer SettingsBuffer {
     SimulationData settings;
 };
 
-layout(binding = 0, r32f) uniform image3D voxelData;
+#define BRICK_TRACKING
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
+#if defined(FUSED_DEPOSIT) && defined(ATOMIC_DEPOSIT)
+// Fixed-point trail accumulator, folded into voxelData by resolve_deposits.glsl
+layout(binding = 3, r32ui) uniform uimage3D depositData;
+
+const float DEPOSIT_FIXED_POINT_SCALE = 65536.0;
+#endif
+
+#define LINEAR_DISPATCH
 
 float sense(vec3 position, vec3 direction, int gridSize, float sensorDistance) {
     // Calculate the sampling position
@@ -33,7 +61,7 @@ float sense(vec3 position, vec3 direction, int gridSize, float sensorDistance) {
     ivec3 sensorPosition = ivec3(clamp(samplePosition, vec3(0.0), vec3(gridSize - 1)));
     #endif
     // Return the voxel data at the sampled position
-    return imageLoad(voxelData, sensorPosition).x;
+    return loadVoxel(sensorPosition);
 }
 
 // Creating overload so that when it isn't used, it will be removed by compiler and there won't be if checks normally
@@ -50,46 +78,67 @@ float sense(vec3 position, vec3 direction, int gridSize, float sensorDistance, b
     #endif
 
     if (debug){
-        imageStore(voxelData, sensorPosition, vec4(0.5));
+        storeVoxel(sensorPosition, 0.5);
+        markOccupied(sensorPosition);
     }
     // Return the voxel data at the sampled position
-    return imageLoad(voxelData, sensorPosition).x;
+    return loadVoxel(sensorPosition);
+}
+
+// Rotate a vector by a unit quaternion (x, y, z, w)
+vec3 rotateVector(vec4 q, vec3 v) {
+    vec3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
 }
 
-// Function to keep orientation matrix orthogonal
-mat3 normalizeMatrix(mat3 m) {
-    m[2] = normalize(m[2]); // Forward
-    m[0] = normalize(cross(m[1], m[2])); // Right
-    m[1] = normalize(cross(m[2], m[0])); // Up
-    return m;
+vec4 multiplyQuaternions(vec4 a, vec4 b) {
+    return vec4(a.w * b.xyz + b.w * a.xyz + cross(a.xyz, b.xyz), a.w * b.w - dot(a.xyz, b.xyz));
 }
 
-// Function to rotate orientation matrix around a given axis
-mat3 rotateOrientation(mat3 orientation, vec3 axis, float angle) {
-    float cosAngle = cos(angle);
-    float sinAngle = sin(angle);
-    mat3 rotationMatrix = mat3(
-    vec3(cosAngle + axis.x * axis.x * (1.0 - cosAngle), axis.x * axis.y * (1.0 - cosAngle) - axis.z * sinAngle, axis.x * axis.z * (1.0 - cosAngle) + axis.y * sinAngle),
-    vec3(axis.y * axis.x * (1.0 - cosAngle) + axis.z * sinAngle, cosAngle + axis.y * axis.y * (1.0 - cosAngle), axis.y * axis.z * (1.0 - cosAngle) - axis.x * sinAngle),
-    vec3(axis.z * axis.x * (1.0 - cosAngle) - axis.y * sinAngle, axis.z * axis.y * (1.0 - cosAngle) + axis.x * sinAngle, cosAngle + axis.z * axis.z * (1.0 - cosAngle))
-    );
-    return rotationMatrix * orientation;
+// Function to rotate an orientation around a given world space axis
+vec4 rotateOrientation(vec4 orientation, vec3 axis, float angle) {
+    // Negated to turn the same way the old orientation matrices did
+    float halfAngle = -angle * 0.5;
+    return multiplyQuaternions(vec4(axis * sin(halfAngle), cos(halfAngle)), orientation);
+}
+
+// Quaternion of the rotation whose columns are right, up and forward
+vec4 orientationFromBasis(vec3 right, vec3 up, vec3 forward) {
+    float trace = right.x + up.y + forward.z;
+    if (trace > 0.0) {
+        float s = sqrt(trace + 1.0) * 2.0;
+        return vec4(up.z - forward.y, forward.x - right.z, right.y - up.x, 0.25 * s * s) / s;
+    }
+    if (right.x > up.y && right.x > forward.z) {
+        float s = sqrt(1.0 + right.x - up.y - forward.z) * 2.0;
+        return vec4(0.25 * s * s, up.x + right.y, forward.x + right.z, up.z - forward.y) / s;
+    }
+    if (up.y > forward.z) {
+        float s = sqrt(1.0 + up.y - right.x - forward.z) * 2.0;
+        return vec4(up.x + right.y, 0.25 * s * s, forward.y + up.z, forward.x - right.z) / s;
+    }
+    float s = sqrt(1.0 + forward.z - right.x - up.y) * 2.0;
+    return vec4(forward.x + right.z, forward.y + up.z, 0.25 * s * s, right.y - up.x) / s;
 }
 
 void main() {
-    uint sporeID = gl_GlobalInvocationID.x;
+    uint sporeID = linearInvocationID();
 
     // Check bounds
     if (sporeID >= settings.spore_count) {
         return;
     }
 
-    Spore spore = spores[sporeID];
-    vec3 sporePosition = spore.position.xyz;
+    SporePosition position = sporePositions[sporeID];
+    vec3 sporePosition = vec3(position.x, position.y, position.z);
+
+    // Renormalize to undo the snorm16 quantization drift
+    SporeOrientation packedOrientation = sporeOrientations[sporeID];
+    vec4 orientation = normalize(vec4(unpackSnorm2x16(packedOrientation.xy), unpackSnorm2x16(packedOrientation.zw)));
 
-    vec3 forward = spore.orientation[2];
-    vec3 up = spore.orientation[1];
-    vec3 right = spore.orientation[0];
+    vec3 forward = rotateVector(orientation, vec3(0.0, 0.0, 1.0));
+    vec3 up = rotateVector(orientation, vec3(0.0, 1.0, 0.0));
+    vec3 right = rotateVector(orientation, vec3(1.0, 0.0, 0.0));
 
 
     // Compute sensor rotation factors
@@ -136,10 +185,10 @@ void main() {
         rotationAngle = settings.turn_speed * settings.delta_time * 6.283; // Turn speed in radians/sec
     }
 
-    // Apply rotation to the orientation matrix
+    // Apply rotation to the orientation
     if (rotationAngle > 0.0) {
-        spore.orientation = rotateOrientation(spore.orientation, rotationAxis, rotationAngle);
-        forward = spore.orientation[2]; // Update forward vector after rotation
+        orientation = normalize(rotateOrientation(orientation, rotationAxis, rotationAngle));
+        forward = rotateVector(orientation, vec3(0.0, 0.0, 1.0)); // Update forward vector after rotation
     }
 
     vec3 newPosition = sporePosition + forward * settings.spore_speed * settings.delta_time;
@@ -157,16 +206,38 @@ void main() {
     // Determine if the spore hit any bounds
     bvec3 hitMask = notEqual(newPosition, storePosition);
 
-    // Update forward
-    spore.orientation[2] = forward * mix(vec3(1.0), vec3(-1.0), vec3(hitMask));
+    // Reflect forward and rebuild an orthonormal basis around it
+    if (any(hitMask)) {
+        forward *= mix(vec3(1.0), vec3(-1.0), vec3(hitMask));
+        up = rotateVector(orientation, vec3(0.0, 1.0, 0.0));
+        right = normalize(cross(up, forward));
+        up = cross(forward, right);
+        orientation = orientationFromBasis(right, up, forward);
+    }
+
+    #endif
+    // Write the updated spore back to the buffers
+    sporePositions[sporeID] = SporePosition(newPosition.x, newPosition.y, newPosition.z);
+    sporeOrientations[sporeID] = SporeOrientation(packSnorm2x16(orientation.xy), packSnorm2x16(orientation.zw));
 
+    #if defined(SPARSE_GRID) && !defined(FUSED_DEPOSIT)
+    // Give the brick this spore deposits into a pool slot, draw_spores.glsl writes it in the next dispatch
+    allocateBrick(clamp(ivec3(floor(newPosition)), ivec3(0), ivec3(settings.grid_size - 1)) / SPARSE_BRICK_SIZE);
     #endif
-    // Normalize the matrix:
-    spore.orientation = normalizeMatrix(spore.orientation);
 
-    // Update the spore's position
-    spore.position = vec4(newPosition, 0.0);
+    #ifdef FUSED_DEPOSIT
+    // Deposit straight away instead of re-reading the spore in draw_spores.glsl
+    int gridSize = settings.grid_size;
+    ivec3 voxelCoord = clamp(ivec3(floor(newPosition)), ivec3(0), ivec3(gridSize - 1));
 
-    // Write the updated spore back to the buffer
-    spores[sporeID] = spore;
+    activateVoxelBrick(voxelCoord);
+
+    #ifdef ATOMIC_DEPOSIT
+    imageAtomicAdd(depositData, voxelCoord, uint(settings.deposit_amount * DEPOSIT_FIXED_POINT_SCALE));
+    #else
+    storeVoxel(voxelCoord, 1.0); // Mark the voxel as occupied by the spore
+    #endif
+
+    markOccupied(voxelCoord);
+    #endif
 }
@@ -0,0 +1,29 @@
+#version 430
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Single invocation, runs once the deposit passes have finished listing bricks
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define BRICK_TRACKING
+
+
+void main() {
+    uint brickCount = nextBricks.brick_count;
+
+    // Fold the list into a 2D grid of workgroups, shaders rebuild the slot with activeBrickSlot()
+    nextBricks.dispatch_x = min(brickCount, MAX_INDIRECT_GROUPS_X);
+    nextBricks.dispatch_y = (brickCount + MAX_INDIRECT_GROUPS_X - 1u) / MAX_INDIRECT_GROUPS_X;
+    nextBricks.dispatch_z = 1u;
+
+    // This frame's list has been consumed, it gets refilled as next frame's nextBricks
+    activeBricks.dispatch_x = 0u;
+    activeBricks.dispatch_y = 0u;
+    activeBricks.dispatch_z = 0u;
+    activeBricks.brick_count = 0u;
+}
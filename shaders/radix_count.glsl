@@ -0,0 +1,58 @@
+#version 430
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Each workgroup is one block of the radix sort
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+layout(std430, binding = 5) buffer SortKeysBuffer {
+    uint sortKeys[];
+};
+
+// Digit-major counts, histogram[digit * blockCount + block], scanned by radix_scan.glsl
+layout(std430, binding = 9) buffer SortHistogramBuffer {
+    uint histogram[];
+};
+
+const uint RADIX = 16u;
+const uint BLOCK_SIZE = 256u;
+
+uniform int radixShift;
+
+shared uint blockHistogram[RADIX];
+
+#define LINEAR_DISPATCH
+
+void main() {
+    uint localID = gl_LocalInvocationID.x;
+    uint block = linearWorkGroupID();
+    uint blockCount = (uint(settings.spore_count) + BLOCK_SIZE - 1u) / BLOCK_SIZE;
+
+    // Padding groups of a folded dispatch would write into the next digit's counts
+    if (block >= blockCount) {
+        return;
+    }
+
+    if (localID < RADIX) {
+        blockHistogram[localID] = 0u;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    uint sporeID = linearInvocationID();
+    if (sporeID < settings.spore_count) {
+        uint digit = (sortKeys[sporeID] >> uint(radixShift)) & (RADIX - 1u);
+        atomicAdd(blockHistogram[digit], 1u);
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (localID < RADIX) {
+        histogram[localID * blockCount + block] = blockHistogram[localID];
+    }
+}
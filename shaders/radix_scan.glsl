@@ -0,0 +1,60 @@
+#version 430
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Dispatched as a single workgroup, every invocation scans its own run of the histogram
+layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+layout(std430, binding = 9) buffer SortHistogramBuffer {
+    uint histogram[];
+};
+
+const uint RADIX = 16u;
+const uint BLOCK_SIZE = 256u;
+const uint SCAN_THREADS = 1024u;
+
+shared uint runTotals[SCAN_THREADS];
+
+void main() {
+    uint localID = gl_LocalInvocationID.x;
+    uint blockCount = (uint(settings.spore_count) + BLOCK_SIZE - 1u) / BLOCK_SIZE;
+    uint histogramSize = RADIX * blockCount;
+
+    uint runLength = (histogramSize + SCAN_THREADS - 1u) / SCAN_THREADS;
+    uint runStart = min(localID * runLength, histogramSize);
+    uint runEnd = min(runStart + runLength, histogramSize);
+
+    uint total = 0u;
+    for (uint i = runStart; i < runEnd; ++i) {
+        total += histogram[i];
+    }
+    runTotals[localID] = total;
+    memoryBarrierShared();
+    barrier();
+
+    // Inclusive Hillis-Steele scan of the run totals
+    for (uint offset = 1u; offset < SCAN_THREADS; offset <<= 1) {
+        uint value = runTotals[localID];
+        if (localID >= offset) {
+            value += runTotals[localID - offset];
+        }
+        memoryBarrierShared();
+        barrier();
+        runTotals[localID] = value;
+        memoryBarrierShared();
+        barrier();
+    }
+
+    // Rewrite the run as an exclusive prefix sum
+    uint runningTotal = runTotals[localID] - total;
+    for (uint i = runStart; i < runEnd; ++i) {
+        uint count = histogram[i];
+        histogram[i] = runningTotal;
+        runningTotal += count;
+    }
+}
@@ -0,0 +1,115 @@
+#version 430
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Each workgroup is one block of the radix sort
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+layout(std430, binding = 5) buffer SortKeysBuffer {
+    uint sortKeys[];
+};
+
+layout(std430, binding = 6) buffer SortValuesBuffer {
+    uint sortValues[];
+};
+
+layout(std430, binding = 7) buffer SortedKeysBuffer {
+    uint sortedKeys[];
+};
+
+layout(std430, binding = 8) buffer SortedValuesBuffer {
+    uint sortedValues[];
+};
+
+// Exclusive scan from radix_scan.glsl, the first output slot of each digit in each block
+layout(std430, binding = 9) buffer SortHistogramBuffer {
+    uint histogram[];
+};
+
+const uint RADIX_BITS = 4u;
+const uint RADIX = 16u;
+const uint BLOCK_SIZE = 256u;
+const uint INVALID_VALUE = 0xFFFFFFFFu; // Padding past spore_count, sorts last and is never written
+
+uniform int radixShift;
+
+shared uint blockKeys[BLOCK_SIZE];
+shared uint blockValues[BLOCK_SIZE];
+shared uint zeroScan[BLOCK_SIZE];
+shared uint digitStart[RADIX];
+
+#define LINEAR_DISPATCH
+
+uint digitOf(uint key) {
+    return (key >> uint(radixShift)) & (RADIX - 1u);
+}
+
+void main() {
+    uint localID = gl_LocalInvocationID.x;
+    uint block = linearWorkGroupID();
+    uint blockCount = (uint(settings.spore_count) + BLOCK_SIZE - 1u) / BLOCK_SIZE;
+    if (block >= blockCount) {
+        return;
+    }
+
+    uint sporeID = linearInvocationID();
+    bool valid = sporeID < settings.spore_count;
+    uint key = valid ? sortKeys[sporeID] : 0xFFFFFFFFu;
+    uint value = valid ? sortValues[sporeID] : INVALID_VALUE;
+
+    // Stable local sort of the block by the current digit, one bit split at a time
+    for (uint bit = 0u; bit < RADIX_BITS; ++bit) {
+        bool isSet = ((key >> (uint(radixShift) + bit)) & 1u) == 1u;
+
+        zeroScan[localID] = isSet ? 0u : 1u;
+        memoryBarrierShared();
+        barrier();
+
+        for (uint offset = 1u; offset < BLOCK_SIZE; offset <<= 1) {
+            uint count = zeroScan[localID];
+            if (localID >= offset) {
+                count += zeroScan[localID - offset];
+            }
+            memoryBarrierShared();
+            barrier();
+            zeroScan[localID] = count;
+            memoryBarrierShared();
+            barrier();
+        }
+
+        uint totalZeros = zeroScan[BLOCK_SIZE - 1u];
+        uint zerosBefore = zeroScan[localID] - (isSet ? 0u : 1u);
+        uint position = isSet ? totalZeros + (localID - zerosBefore) : zerosBefore;
+
+        blockKeys[position] = key;
+        blockValues[position] = value;
+        memoryBarrierShared();
+        barrier();
+
+        key = blockKeys[localID];
+        value = blockValues[localID];
+        memoryBarrierShared();
+        barrier();
+    }
+
+    // Where each digit's run begins inside the sorted block
+    uint digit = digitOf(key);
+    if (localID == 0u || digitOf(blockKeys[localID - 1u]) != digit) {
+        digitStart[digit] = localID;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (value == INVALID_VALUE) {
+        return;
+    }
+
+    uint destination = histogram[digit * blockCount + block] + (localID - digitStart[digit]);
+    sortedKeys[destination] = key;
+    sortedValues[destination] = value;
+}
@@ -0,0 +1,30 @@
+#version 430
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Lazily decayed grids are always dense, so this walks the whole grid
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define VOXEL_ACCESS
+
+// Rewrites every voxel as its current value written at time 0, simulation_time is reset to 0 right after.
+// Decay is linear, so this ages the voxels exactly as the old timestamps would have
+void main() {
+    ivec3 location = ivec3(gl_GlobalInvocationID.xyz);
+    if (any(greaterThanEqual(location, ivec3(settings.grid_size)))) {
+        return;
+    }
+
+    float voxelValue = decodeVoxel(imageLoad(voxelData, location));
+    imageStore(voxelData, location, vec4(voxelValue, 0.0, 0.0, 0.0));
+}
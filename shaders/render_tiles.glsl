@@ -0,0 +1,252 @@
+#version 430
+
+#define USE_TRANSPARENCY
+
+#define PYRAMID_MARCH
+
+#define SPARSE_GRID
+
+#define WRAP_AROUND
+
+#define TILED_VIEW
+
+#define TEMPORAL_UPSCALE
+
+#define DEPTH_CACHE
+
+#define CONE_PREPASS
+
+// One 8x8 pixel tile per workgroup, neighbouring rays reach the trail close together
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
+#define SDF_SEED
+
+layout(r32ui, binding = 1) uniform readonly uimage3D sdfData;
+
+#ifdef PYRAMID_MARCH
+// Max of the trail grid over 2^(level + 1) voxel cells, built by build_pyramid.glsl
+layout(binding = 8) uniform sampler3D trailPyramid;
+#endif
+
+// Blitted to the screen afterwards, or upscaled by temporal_upscale.glsl first
+layout(rgba16f, binding = 5) uniform writeonly image2D renderTarget;
+
+#ifdef DEPTH_CACHE
+// Hit distances of the last frame and this one at the internal resolution, negative for the background
+layout(r32f, binding = 3) uniform readonly image2D previousDepth;
+layout(r32f, binding = 4) uniform writeonly image2D depthCache;
+#endif
+
+#ifdef CONE_PREPASS
+// Distance from the camera every ray of an 8x8 pixel block can skip, written by cone_march.glsl just before
+layout(r32f, binding = 2) uniform readonly image2D coneDistances;
+#endif
+
+#ifdef TEMPORAL_UPSCALE
+// 0 or 1 picks the half of the pixels marched this frame, the others are filled in from them. -1 marches all of them
+uniform int checkerboardPhase;
+
+shared vec4 tilePixels[gl_WorkGroupSize.x * gl_WorkGroupSize.y];
+#endif
+
+#if !defined(USE_TRANSPARENCY) && !defined(PYRAMID_MARCH)
+// Only the opaque SDF march stops short of the trail before it starts searching cubes
+#define VOXEL_CACHE
+#endif
+
+#ifdef VOXEL_CACHE
+const int VOXEL_CACHE_SIZE = 16; // Voxels per side of the block cached per tile
+const int VOXEL_CACHE_VOLUME = VOXEL_CACHE_SIZE * VOXEL_CACHE_SIZE * VOXEL_CACHE_SIZE;
+const int VOXEL_CACHE_HALO = 2; // Around the SDF stop points, for the cube search and the steps after it
+const int NO_BOUND = 0x3FFFFFFF;
+
+shared float voxelCache[VOXEL_CACHE_VOLUME];
+shared int cacheBounds[6]; // Min then max corner of the voxels the tile's rays stopped in
+
+// Far below the grid until the cache is filled, so every lookup misses it
+ivec3 voxelCacheOrigin = ivec3(-NO_BOUND);
+#endif
+
+// Empty voxels are skipped on the occupancy bit alone
+float fetchTrailVoxel(ivec3 voxel) {
+    return mayBeOccupied(voxel) ? loadVoxel(voxel) : 0.0;
+}
+
+// Trail voxel for the cube search, out of the tile's cache when it covers the voxel
+float loadTrailVoxel(ivec3 voxel) {
+    #ifdef VOXEL_CACHE
+    ivec3 cached = voxel - voxelCacheOrigin;
+    if (all(greaterThanEqual(cached, ivec3(0))) && all(lessThan(cached, ivec3(VOXEL_CACHE_SIZE)))) {
+        return voxelCache[cached.x + VOXEL_CACHE_SIZE * (cached.y + VOXEL_CACHE_SIZE * cached.z)];
+    }
+    #endif
+    return fetchTrailVoxel(voxel);
+}
+
+#define RAY_MARCH
+
+#ifdef VOXEL_CACHE
+// Advances the ray with the SDF alone until map_the_world() would start searching cubes. False if it never gets there
+bool approach_trail(inout vec3 rayOrigin, in vec3 rayDirection) {
+    const int NUMBER_OF_STEPS = 500;
+    const float MAXIMUM_TRACE_DISTANCE = settings.grid_size * 4.0;
+
+    float total_distance_traveled = 0.0;
+    for (int i = 0; i < NUMBER_OF_STEPS; ++i) {
+        if (total_distance_traveled > MAXIMUM_TRACE_DISTANCE || left_grid(rayOrigin)) {
+            return false;
+        }
+
+        float sdfStep = sdf_step(rayOrigin);
+        if (sdfStep < 0.0) {
+            return true;
+        }
+
+        rayOrigin += sdfStep * rayDirection;
+        total_distance_traveled += sdfStep;
+    }
+    return false;
+}
+
+// Loads the voxels around where the tile's rays stopped, every invocation has to take part
+void fill_voxel_cache() {
+    ivec3 boundsMin = ivec3(cacheBounds[0], cacheBounds[1], cacheBounds[2]);
+    if (boundsMin.x == NO_BOUND) {
+        return; // No ray of the tile got close to the trail
+    }
+
+    voxelCacheOrigin = boundsMin - VOXEL_CACHE_HALO;
+    for (int i = int(gl_LocalInvocationIndex); i < VOXEL_CACHE_VOLUME; i += int(gl_WorkGroupSize.x * gl_WorkGroupSize.y)) {
+        ivec3 voxel = voxelCacheOrigin + ivec3(i % VOXEL_CACHE_SIZE, (i / VOXEL_CACHE_SIZE) % VOXEL_CACHE_SIZE, i / (VOXEL_CACHE_SIZE * VOXEL_CACHE_SIZE));
+        bool inGrid = all(greaterThanEqual(voxel, ivec3(0))) && all(lessThan(voxel, ivec3(settings.grid_size)));
+        voxelCache[i] = inGrid ? fetchTrailVoxel(voxel) : 0.0;
+    }
+}
+#endif
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 screenSize = imageSize(renderTarget);
+
+    // Pixels past the edge of the screen still take part in the barriers
+    bool onScreen = all(lessThan(pixel, screenSize));
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(screenSize) * 2.0 - 1.0;
+
+    #ifdef TEMPORAL_UPSCALE
+    bool marched = checkerboardPhase < 0 || ((pixel.x + pixel.y) & 1) == checkerboardPhase;
+    #else
+    bool marched = true;
+    #endif
+
+    vec3 rayOrigin;
+    vec3 rayDirection;
+    bool hitsGrid = onScreen && marched && camera_ray(uv, rayOrigin, rayDirection);
+
+    #ifdef CONE_PREPASS
+    if (hitsGrid) {
+        skip_to_cone_distance(pixel, rayOrigin, rayDirection);
+    }
+    #endif
+    #ifdef DEPTH_CACHE
+    if (hitsGrid) {
+        skip_to_cached_depth(pixel, rayOrigin, rayDirection);
+    }
+    #endif
+
+    vec3 color = vec3(0.0); // Background color
+
+    #ifdef VOXEL_CACHE
+    if (gl_LocalInvocationIndex == 0) {
+        for (int i = 0; i < 3; ++i) {
+            cacheBounds[i] = NO_BOUND;
+            cacheBounds[i + 3] = -NO_BOUND;
+        }
+    }
+    barrier();
+
+    if (hitsGrid && approach_trail(rayOrigin, rayDirection)) {
+        ivec3 voxel = ivec3(floor(rayOrigin));
+        #ifdef TILED_VIEW
+        voxel = tile_voxel(voxel); // The cube search looks voxels up wrapped
+        #endif
+        for (int i = 0; i < 3; ++i) {
+            atomicMin(cacheBounds[i], voxel[i]);
+            atomicMax(cacheBounds[i + 3], voxel[i]);
+        }
+    }
+    barrier();
+
+    fill_voxel_cache();
+    barrier();
+
+    if (hitsGrid) {
+        color = ray_march(rayOrigin, rayDirection);
+    }
+    #else
+    if (hitsGrid) {
+        color = trace_ray(rayOrigin, rayDirection);
+    }
+    #endif
+
+    #ifdef TEMPORAL_UPSCALE
+    // Alpha is the distance from the camera to what the pixel shows, negative for the background
+    vec4 result = vec4(color, ray_hit_distance());
+
+    tilePixels[gl_LocalInvocationIndex] = result;
+    barrier();
+
+    if (!marched) {
+        // Average the marched neighbours inside the tile, a checkerboard leaves at least two of them.
+        // The nearest of their hits keeps the reprojection on the trail rather than the background
+        ivec2 local = ivec2(gl_LocalInvocationID.xy);
+        ivec2 neighborOffsets[] = ivec2[](ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1));
+        vec3 colorSum = vec3(0.0);
+        float neighborCount = 0.0;
+        float hitDistance = -1.0;
+        for (int i = 0; i < neighborOffsets.length(); ++i) {
+            ivec2 neighbor = local + neighborOffsets[i];
+            if (any(lessThan(neighbor, ivec2(0))) || any(greaterThanEqual(neighbor, ivec2(gl_WorkGroupSize.xy))) ||
+                any(greaterThanEqual(pixel + neighborOffsets[i], screenSize))) {
+                continue;
+            }
+
+            vec4 neighborPixel = tilePixels[neighbor.x + neighbor.y * int(gl_WorkGroupSize.x)];
+            colorSum += neighborPixel.rgb;
+            neighborCount += 1.0;
+            if (neighborPixel.a >= 0.0 && (hitDistance < 0.0 || neighborPixel.a < hitDistance)) {
+                hitDistance = neighborPixel.a;
+            }
+        }
+        result = vec4(colorSum / max(neighborCount, 1.0), hitDistance);
+    }
+    // A skipped checkerboard pixel did not see its own hit, so nothing behind 0 is known. Borrowing a neighbour's
+    // could start the next march of this pixel past a strand only it sees
+    float cachedDistance = marched ? result.a : 0.0;
+    #else
+    vec4 result = vec4(color, 1.0);
+    float cachedDistance = ray_hit_distance();
+    #endif
+
+    if (onScreen) {
+        imageStore(renderTarget, pixel, result);
+        #ifdef DEPTH_CACHE
+        imageStore(depthCache, pixel, vec4(cachedDistance));
+        #endif
+    }
+}
@@ -0,0 +1,50 @@
+#version 430
+
+#define SPORE_STRUCT
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 8, local_size_y = 1, local_size_z = 1) in;
+
+// Buffers
+layout(std430, binding = 0) buffer SporePositionsBuffer {
+    SporePosition sporePositions[];
+};
+
+layout(std430, binding = 11) buffer SporeOrientationsBuffer {
+    SporeOrientation sporeOrientations[];
+};
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+// Spore indices in Morton order, from the radix sort
+layout(std430, binding = 6) buffer SortValuesBuffer {
+    uint sortValues[];
+};
+
+// Swapped with the spore buffers afterwards
+layout(std430, binding = 10) buffer SortedSporePositionsBuffer {
+    SporePosition sortedSporePositions[];
+};
+
+layout(std430, binding = 12) buffer SortedSporeOrientationsBuffer {
+    SporeOrientation sortedSporeOrientations[];
+};
+
+#define LINEAR_DISPATCH
+
+void main() {
+    uint sporeID = linearInvocationID();
+
+    // Check bounds
+    if (sporeID >= settings.spore_count) {
+        return;
+    }
+
+    uint sourceID = sortValues[sporeID];
+    sortedSporePositions[sporeID] = sporePositions[sourceID];
+    sortedSporeOrientations[sporeID] = sporeOrientations[sourceID];
+}
@@ -0,0 +1,95 @@
+#version 430
+
+#define SPARSE_SOURCE
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+// Already reallocated at settings.grid_size and in the current voxel format
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+
+// The grid before reallocating, deleted after this pass. Read through a sampler as its format may differ.
+// Lazily decayed grids are only resampled into lazily decayed grids, so decodeVoxel() applies to both
+layout(binding = 5) uniform sampler3D sourceVoxelGrid;
+
+#ifdef SPARSE_SOURCE
+// sourceVoxelGrid is the old brick pool, found through the old brick table
+layout(binding = 6) uniform usampler3D sourceBrickTable;
+
+uniform int sourcePoolSide;
+#endif
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define BRICK_TRACKING
+
+#define VOXEL_ACCESS
+
+#define OCCUPANCY
+
+uniform int sourceGridSize;
+uniform int allocateBricks; // First of the two passes into a sparse grid, which only gives the trail bricks a slot
+
+float loadSourceVoxel(ivec3 voxel) {
+    #ifdef SPARSE_SOURCE
+    // Same brick table entries and pool layout as voxel_access.glsl
+    const int brickSize = 8;
+    uint entry = texelFetch(sourceBrickTable, voxel / brickSize, 0).x;
+    if (entry == 0u || entry == 0xFFFFFFFFu) {
+        return 0.0;
+    }
+    uint slot = entry - 1u;
+    uint side = uint(sourcePoolSide);
+    voxel = ivec3(slot % side, (slot / side) % side, slot / (side * side)) * brickSize + voxel % brickSize;
+    #endif
+    return decodeVoxel(texelFetch(sourceVoxelGrid, voxel, 0));
+}
+
+void main() {
+    int gridSize = settings.grid_size;
+    ivec3 location = ivec3(gl_GlobalInvocationID.xyz);
+
+    if (any(greaterThanEqual(location, ivec3(gridSize)))) {
+        return;
+    }
+
+    // Source voxels this voxel covers, a single one when growing
+    float scale = float(sourceGridSize) / float(gridSize);
+    ivec3 first = min(ivec3(vec3(location) * scale), ivec3(sourceGridSize - 1));
+    ivec3 last = clamp(ivec3(ceil(vec3(location + 1) * scale)) - 1, first, ivec3(sourceGridSize - 1));
+
+    // Max instead of average so thin trails survive shrinking the grid
+    float voxelValue = 0.0;
+    for (int z = first.z; z <= last.z; ++z) {
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                voxelValue = max(voxelValue, loadSourceVoxel(ivec3(x, y, z)));
+            }
+        }
+    }
+
+    #ifdef SPARSE_GRID
+    // storeVoxel() drops writes into bricks without a slot, so they are allocated in a dispatch of their own
+    if (allocateBricks != 0) {
+        if (voxelValue > 0.0) {
+            allocateBrick(location / SPARSE_BRICK_SIZE);
+        }
+        return;
+    }
+    #endif
+
+    storeVoxel(location, voxelValue);
+
+    // The occupancy volume is reallocated zeroed along with the grid
+    if (voxelValue > 0.0) {
+        activateVoxelBrick(location);
+        markOccupied(location);
+    }
+}
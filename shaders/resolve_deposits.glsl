@@ -0,0 +1,50 @@
+#version 430
+
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+// Dispatched indirectly, one workgroup per brick listed this frame
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// Trail grid format
+#define VOXEL_FORMAT
+
+layout(binding = 0, VOXEL_FORMAT) uniform image3D voxelData;
+layout(binding = 3, r32ui) uniform uimage3D depositData;
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+#define BRICK_TRACKING
+
+const float DEPOSIT_FIXED_POINT_SCALE = 65536.0;
+
+
+void main() {
+    uint brickSlot = activeBrickSlot();
+    if (brickSlot >= activeBricks.brick_count) {
+        return;
+    }
+
+    ivec3 location = unpackBrick(activeBricks.bricks[brickSlot]) * BRICK_SIZE + ivec3(gl_LocalInvocationID.xyz);
+
+    // Ensure the indices are within the bounds of the grid
+    if (any(greaterThanEqual(location, ivec3(settings.grid_size)))) {
+        return;
+    }
+
+    uint deposited = imageLoad(depositData, location).x;
+
+    // Most voxels receive nothing, so skip the read-modify-write on the trail grid
+    if (deposited == 0u) {
+        return;
+    }
+
+    // Accumulate this frame's deposits. The cap is the 1.0 the non-atomic path writes for every spore, so both modes
+    // saturate at the same value, but here a voxel only gets there after 1 / deposit_amount spore visits
+    float voxelValue = min(1.0, imageLoad(voxelData, location).x + float(deposited) / DEPOSIT_FIXED_POINT_SCALE);
+    imageStore(voxelData, location, vec4(voxelValue));
+    imageStore(depositData, location, uvec4(0u));
+}
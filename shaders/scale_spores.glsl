@@ -8,8 +8,8 @@
 layout(local_size_x = 8, local_size_y = 1, local_size_z = 1) in;
 
 // Buffers
-layout(std430, binding = 0) buffer SporesBuffer {
-    Spore spores[];
+layout(std430, binding = 0) buffer SporePositionsBuffer {
+    SporePosition sporePositions[];
 };
 
 layout(std430, binding = 1) buffer SettingsBuffer {
@@ -18,19 +18,23 @@ layout(std430, binding = 1) buffer SettingsBuffer {
 
 uniform int maxSporeSize;
 
+#define LINEAR_DISPATCH
+
 void main() {
-    uint sporeID = gl_GlobalInvocationID.x;
+    uint sporeID = linearInvocationID();
 
     // Check bounds
     if (sporeID >= maxSporeSize) {
         return;
     }
 
-    Spore spore = spores[sporeID];
+    SporePosition position = sporePositions[sporeID];
 
     // Scale the spore position based on the gridRatio
-    spore.position.xyz *= settings.grid_resize_factor;
+    position.x *= settings.grid_resize_factor;
+    position.y *= settings.grid_resize_factor;
+    position.z *= settings.grid_resize_factor;
 
     // Write the updated spore back to the buffer
-    spores[sporeID] = spore;
+    sporePositions[sporeID] = position;
 }
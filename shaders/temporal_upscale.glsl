@@ -0,0 +1,85 @@
+#version 430
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Simulation Settings
+#define SIMULATION_SETTINGS
+
+layout(std430, binding = 1) buffer SettingsBuffer {
+    SimulationData settings;
+};
+
+// This frame's march from render_tiles.glsl at the internal resolution, alpha is the distance to the hit
+layout(binding = 9) uniform sampler2D currentFrame;
+
+// Last frame's output at the screen resolution
+layout(binding = 10) uniform sampler2D historyFrame;
+
+layout(rgba8, binding = 5) uniform writeonly image2D upscaledFrame;
+
+uniform int historyValid; // 0 after a resize or when upscaling was just turned on
+
+const float HISTORY_WEIGHT = 0.85;
+const float BACKGROUND_DISTANCE = 1e4; // The background is reprojected as if it were far away
+
+// Same camera as camera_ray() in ray_march.glsl
+void camera_basis(in vec3 position, in vec3 focus, out vec3 forward, out vec3 right, out vec3 up) {
+    forward = normalize(focus - position);
+    right = normalize(cross(vec3(0.0, 1.0, 0.0), forward));
+    up = cross(forward, right);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 screenSize = imageSize(upscaledFrame);
+    if (any(greaterThanEqual(pixel, screenSize))) {
+        return;
+    }
+
+    vec2 texCoord = (vec2(pixel) + 0.5) / vec2(screenSize);
+    vec3 current = texture(currentFrame, texCoord).rgb;
+
+    // Depth is not interpolated across edges, and the neighbourhood bounds what the history may contribute
+    ivec2 lowResSize = textureSize(currentFrame, 0);
+    ivec2 lowResPixel = min(ivec2(texCoord * vec2(lowResSize)), lowResSize - 1);
+    float hitDistance = texelFetch(currentFrame, lowResPixel, 0).a;
+
+    vec3 neighborhoodMin = vec3(1e6);
+    vec3 neighborhoodMax = vec3(-1e6);
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            vec3 neighbor = texelFetch(currentFrame, clamp(lowResPixel + ivec2(x, y), ivec2(0), lowResSize - 1), 0).rgb;
+            neighborhoodMin = min(neighborhoodMin, neighbor);
+            neighborhoodMax = max(neighborhoodMax, neighbor);
+        }
+    }
+
+    if (historyValid == 0) {
+        imageStore(upscaledFrame, pixel, vec4(current, 1.0));
+        return;
+    }
+
+    // Rebuild where this pixel's ray hit and find that point on last frame's screen
+    vec3 forward;
+    vec3 right;
+    vec3 up;
+    camera_basis(settings.camera_position.xyz, settings.camera_focus.xyz, forward, right, up);
+    vec2 adjustedUV = texCoord * 2.0 - 1.0;
+    adjustedUV.x *= settings.aspect_ratio;
+    vec3 rayDirection = normalize(adjustedUV.x * right + adjustedUV.y * up + forward);
+    vec3 hitPoint = settings.camera_position.xyz + rayDirection * (hitDistance < 0.0 ? BACKGROUND_DISTANCE : hitDistance);
+
+    vec3 previousPosition = settings.previous_camera_position.xyz;
+    camera_basis(previousPosition, settings.previous_camera_focus.xyz, forward, right, up);
+    vec3 toHit = hitPoint - previousPosition;
+    float depth = dot(toHit, forward);
+    vec2 previousUV = vec2(dot(toHit, right) / settings.aspect_ratio, dot(toHit, up)) / depth;
+
+    vec3 color = current;
+    if (depth > 0.0 && all(lessThanEqual(abs(previousUV), vec2(1.0)))) {
+        vec3 history = texture(historyFrame, previousUV * 0.5 + 0.5).rgb;
+        color = mix(current, clamp(history, neighborhoodMin, neighborhoodMax), HISTORY_WEIGHT);
+    }
+
+    imageStore(upscaledFrame, pixel, vec4(color, 1.0));
+}
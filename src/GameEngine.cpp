@@ -250,6 +250,15 @@ void GameEngine::removeShaderDefinition(const std::string &placeholder) {
     }
 }
 
+// Keeps the placeholder's #define when enabled and maps it to nothing otherwise, whichever state it was in before
+void GameEngine::setShaderDefinitionEnabled(const std::string &placeholder, const bool enabled) {
+    if (enabled) {
+        shaderDefinitions.erase(placeholder);
+    } else {
+        shaderDefinitions[placeholder] = "";
+    }
+}
+
 GLuint GameEngine::CompileAndAttachShader(const std::string& source, const GLenum shaderType, const GLuint program) {
     const GLuint shader = CompileShader(source, shaderType);
     glAttachShader(program, shader);
@@ -479,10 +488,17 @@ void GameEngine::DispatchComputeShader(const GLuint computeShaderProgram,
     const int localSizeZ = localSize[2];
 
     // Calculate the number of work groups required for each dimension
-    const int workGroupCountX = (itemsX + localSizeX - 1) / localSizeX; // ceil(itemsX / localSizeX)
-    const int workGroupCountY = (itemsY + localSizeY - 1) / localSizeY;
+    int workGroupCountX = (itemsX + localSizeX - 1) / localSizeX; // ceil(itemsX / localSizeX)
+    int workGroupCountY = (itemsY + localSizeY - 1) / localSizeY;
     const int workGroupCountZ = (itemsZ + localSizeZ - 1) / localSizeZ;
 
+    // Fold 1D dispatches that are too wide into rows, shaders rebuild the linear id with linear_dispatch.glsl.
+    // The last row may run past itemsX, so those shaders have to bounds check their linear id.
+    if (workGroupCountX > maxWorkGroupCountX && itemsY == 1 && itemsZ == 1) {
+        workGroupCountY = (workGroupCountX + maxWorkGroupCountX - 1) / maxWorkGroupCountX;
+        workGroupCountX = (workGroupCountX + workGroupCountY - 1) / workGroupCountY;
+    }
+
     // Validate against maximum work group count bounds
     if (workGroupCountX > maxWorkGroupCountX ||
         workGroupCountY > maxWorkGroupCountY ||
@@ -511,3 +527,36 @@ void GameEngine::DispatchComputeShader(const GLuint computeShaderProgram,
     // Ensure the compute shader completes before continuing
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
+
+void GameEngine::DispatchComputeShaderIndirect(const GLuint computeShaderProgram,
+                                               const GLuint indirectBuffer, const GLintptr offset) const {
+    if (computeShaderProgram == 0) {
+        throw std::runtime_error("Shader Program not initialized");
+    }
+
+    if (indirectBuffer == 0) {
+        throw std::runtime_error("Indirect dispatch buffer not initialized");
+    }
+
+    // Bind the compute shader program
+    glUseProgram(computeShaderProgram);
+
+    // The work group counts are read from the buffer on the GPU, so make sure the writes to it are visible
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectBuffer);
+
+    glDispatchComputeIndirect(offset);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    // Check for errors
+    GLenum err;
+    // ReSharper disable once CppDFALoopConditionNotUpdated
+    while ((err = glGetError()) != GL_NO_ERROR) {
+        std::cerr << "OpenGL Error: " << err << std::endl;
+        throw std::runtime_error("Error occurred during indirect compute shader dispatch.");
+    }
+
+    // Ensure the compute shader completes before continuing
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
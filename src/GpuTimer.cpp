@@ -0,0 +1,72 @@
+#include "GpuTimer.h"
+
+GpuTimer::~GpuTimer() {
+    if (queries[0])
+        glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void GpuTimer::collectResults() {
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!pending[i]) {
+            continue;
+        }
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+
+        GLuint64 elapsedNanoseconds = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsedNanoseconds);
+        pending[i] = false;
+
+        // Several can finish at once, keep the newest
+        if (submitted[i] > latestCollected) {
+            latestCollected = submitted[i];
+            milliseconds = static_cast<float>(elapsedNanoseconds) / 1'000'000.0f;
+            measured = true;
+        }
+    }
+}
+
+void GpuTimer::begin() {
+    // Created on first use so the timer can be declared before the context exists
+    if (!queries[0]) {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    collectResults();
+
+    // Skip this measurement if every query is still in flight
+    activeQuery = -1;
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!pending[i]) {
+            activeQuery = i;
+            break;
+        }
+    }
+
+    if (activeQuery != -1) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery]);
+    }
+}
+
+void GpuTimer::end() {
+    if (activeQuery == -1) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[activeQuery] = true;
+    submitted[activeQuery] = ++submissionCount;
+    activeQuery = -1;
+}
+
+float GpuTimer::getMilliseconds() const {
+    return milliseconds;
+}
+
+bool GpuTimer::hasResult() const {
+    return measured;
+}
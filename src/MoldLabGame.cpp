@@ -1,6 +1,9 @@
 #include <iostream>
 #include <linmath.h>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <numeric>
 #include "MoldLabGame.h"
 #include "MeshData.h"
 #include "imgui.h"
@@ -9,14 +12,115 @@ const std::string USE_TRANSPARENCY_DEFINITION = "#define USE_TRANSPARENCY";
 const std::string SIMULATION_SETTINGS_DEFINITION = "#define SIMULATION_SETTINGS";
 const std::string SPORE_DEFINITION = "#define SPORE_STRUCT";
 const std::string WRAP_GRID_DEFINITION = "#define WRAP_AROUND";
-
+const std::string FUSED_DEPOSIT_DEFINITION = "#define FUSED_DEPOSIT";
+const std::string ATOMIC_DEPOSIT_DEFINITION = "#define ATOMIC_DEPOSIT";
+const std::string SEPARABLE_DIFFUSION_DEFINITION = "#define SEPARABLE_DIFFUSION";
+const std::string BRICK_TRACKING_DEFINITION = "#define BRICK_TRACKING";
+const std::string LINEAR_DISPATCH_DEFINITION = "#define LINEAR_DISPATCH";
+const std::string ACTIVE_BRICKS_ONLY_DEFINITION = "#define ACTIVE_BRICKS_ONLY";
+const std::string VOXEL_FORMAT_DEFINITION = "#define VOXEL_FORMAT";
+const std::string VOXEL_ACCESS_DEFINITION = "#define VOXEL_ACCESS";
+const std::string SPARSE_GRID_DEFINITION = "#define SPARSE_GRID";
+const std::string SPARSE_SOURCE_DEFINITION = "#define SPARSE_SOURCE";
+const std::string TEMPORAL_JFA_DEFINITION = "#define TEMPORAL_JFA";
+const std::string SEPARABLE_JFA_DEFINITION = "#define SEPARABLE_JFA";
+const std::string SDF_SEED_DEFINITION = "#define SDF_SEED";
+const std::string OCCUPANCY_DEFINITION = "#define OCCUPANCY";
+const std::string PYRAMID_BASE_DEFINITION = "#define PYRAMID_BASE";
+const std::string PYRAMID_MARCH_DEFINITION = "#define PYRAMID_MARCH";
+const std::string TILED_VIEW_DEFINITION = "#define TILED_VIEW";
+const std::string RAY_MARCH_DEFINITION = "#define RAY_MARCH";
+const std::string TEMPORAL_UPSCALE_DEFINITION = "#define TEMPORAL_UPSCALE";
+const std::string DEPTH_CACHE_DEFINITION = "#define DEPTH_CACHE";
+const std::string CONE_PREPASS_DEFINITION = "#define CONE_PREPASS";
+
+// Trail grid formats, the definition file sets the matching image format qualifier in the shaders
+struct VoxelFormat {
+    const char *name;
+    GLenum internalFormat;
+    const char *definitionFile;
+    bool lazyDecay; // Voxels are decayed when read, so there is no decay pass
+};
+
+const VoxelFormat VOXEL_FORMATS[] = {
+    {"R32F", GL_R32F, "shaders/common/voxel_format_r32f.glsl", false},
+    {"R16F", GL_R16F, "shaders/common/voxel_format_r16f.glsl", false},
+    {"R8", GL_R8, "shaders/common/voxel_format_r8.glsl", false},
+    {"RG32F Lazy Decay", GL_RG32F, "shaders/common/voxel_format_lazy_decay.glsl", true},
+};
+
+
+// Nearest seed cell packed 10:10:10, see shaders/common/sdf_seed.glsl. Limits the SDF to 1024 cells per side
+constexpr GLenum SDF_INTERNAL_FORMAT = GL_R32UI;
 
 constexpr int GRID_TEXTURE_LOCATION = 0;
 constexpr int SDF_TEXTURE_READ_LOCATION = 1;
 constexpr int SDF_TEXTURE_WRITE_LOCATION = 2;
-
-constexpr int SPORE_BUFFER_LOCATION = 0;
+constexpr int DEPOSIT_TEXTURE_LOCATION = 3;
+constexpr int GRID_TEXTURE_WRITE_LOCATION = 4;
+constexpr int RESAMPLE_SOURCE_TEXTURE_LOCATION = 5;
+constexpr int RESAMPLE_SOURCE_TABLE_TEXTURE_LOCATION = 6; // Texture unit, the old brick table when resampling a sparse grid
+constexpr int RENDER_TARGET_LOCATION = 5; // Image unit, 5 is only taken as a texture unit
+constexpr int CURRENT_FRAME_TEXTURE_LOCATION = 9; // Texture unit temporal_upscale.glsl samples the internal resolution march from
+constexpr int HISTORY_TEXTURE_LOCATION = 10;
+// Image units, only 8 are guaranteed. The render programs never touch the deposit and diffusion grids, which are
+// bound again before every simulation step
+constexpr int PREVIOUS_DEPTH_LOCATION = DEPOSIT_TEXTURE_LOCATION;
+constexpr int DEPTH_CACHE_LOCATION = GRID_TEXTURE_WRITE_LOCATION;
+constexpr int CONE_DISTANCE_LOCATION = SDF_TEXTURE_WRITE_LOCATION; // Image unit, every jump flood pass binds its own target
+constexpr int CONE_BLOCK_SIZE = 8; // Pixels per side of a cone_march.glsl block, as in ray_march.glsl
+constexpr int BRICK_TABLE_TEXTURE_LOCATION = 6;
+constexpr int OCCUPANCY_TEXTURE_LOCATION = 7;
+constexpr int PYRAMID_READ_LOCATION = SDF_TEXTURE_READ_LOCATION; // Image units, the SDF is bound again once the pyramid is built
+constexpr int PYRAMID_WRITE_LOCATION = SDF_TEXTURE_WRITE_LOCATION;
+constexpr int PYRAMID_TEXTURE_LOCATION = 8; // Texture unit the renderer samples the pyramid from
+
+constexpr int SPORE_POSITION_BUFFER_LOCATION = 0;
 constexpr int SIMULATION_BUFFER_LOCATION = 1;
+constexpr int ACTIVE_BRICK_BUFFER_LOCATION = 2;
+constexpr int NEXT_BRICK_BUFFER_LOCATION = 3;
+constexpr int BRICK_STAMP_BUFFER_LOCATION = 4;
+constexpr int SORT_KEYS_BUFFER_LOCATION = 5;
+constexpr int SORT_VALUES_BUFFER_LOCATION = 6;
+constexpr int SORTED_KEYS_BUFFER_LOCATION = 7;
+constexpr int SORTED_VALUES_BUFFER_LOCATION = 8;
+constexpr int SORT_HISTOGRAM_BUFFER_LOCATION = 9;
+constexpr int SORTED_SPORE_POSITION_BUFFER_LOCATION = 10;
+constexpr int SPORE_ORIENTATION_BUFFER_LOCATION = 11;
+constexpr int SORTED_SPORE_ORIENTATION_BUFFER_LOCATION = 12;
+constexpr int BRICK_POOL_BUFFER_LOCATION = 13;
+constexpr int SDF_ERROR_BUFFER_LOCATION = 14;
+
+// Spore buffers grow by doubling and shrink to twice the count once a quarter or less is in use
+constexpr int SPORE_GROWTH_FACTOR = 2;
+constexpr int SPORE_SHRINK_RATIO = 4;
+
+// Must match the radix sort shaders
+constexpr int RADIX_BITS = 4;
+constexpr int RADIX = 1 << RADIX_BITS;
+constexpr int RADIX_BLOCK_SIZE = 256;
+constexpr int MORTON_KEY_BITS = 32;
+
+// Must match shaders/common/brick_tracking.glsl
+constexpr int BRICK_SIZE = 8;
+constexpr int BRICK_LIST_HEADER_SIZE = 4; // Indirect dispatch x, y, z and the brick count
+
+// Voxels per occupancy bitmask word, must match shaders/common/occupancy.glsl
+constexpr int OCCUPANCY_WORD_SIZE_X = 4;
+constexpr int OCCUPANCY_WORD_SIZE_Y = 4;
+constexpr int OCCUPANCY_WORD_SIZE_Z = 2;
+
+// Levels of the trail max pyramid, level 0 cells cover 2^3 voxels and the top level 2^TRAIL_PYRAMID_LEVELS per side
+constexpr int TRAIL_PYRAMID_LEVELS = 6;
+
+// Seconds simulation_time runs before it is brought back to 0, well before float seconds stop resolving a frame
+constexpr float SIMULATION_TIME_REBASE = 1024.0f;
+
+// Fraction of the grid's bricks the sparse brick pool starts out with room for
+constexpr double SPARSE_POOL_OCCUPANCY = 0.125;
+constexpr int BRICK_POOL_HEADER_SIZE = 2; // Free slot count and failed allocations, must match shaders/common/voxel_access.glsl
+constexpr int SPARSE_POOL_CHECK_INTERVAL = 30; // Frames between readbacks of the brick pool's header
+constexpr double SPARSE_POOL_LOW_FRACTION = 0.125; // The pool grows once fewer of its slots than this are free
 
 // ============================
 // Constructor/Destructor
@@ -30,6 +134,8 @@ void assignDefaultsToSimulationData(SimulationData& data, float aspectRatio) {
     data.turn_speed = SimulationDefaults::SPORE_TURN_SPEED;
     data.sensor_distance = SimulationDefaults::SPORE_SENSOR_DISTANCE;
     data.sensor_angle = SimulationDefaults::SPORE_SENSOR_ANGLE;
+    data.deposit_amount = SimulationDefaults::DEPOSIT_AMOUNT;
+    data.diffuse_speed = SimulationDefaults::DIFFUSE_SPEED;
     data.aspect_ratio = aspectRatio;
 }
 
@@ -41,10 +147,29 @@ MoldLabGame::MoldLabGame(const int width, const int height, const std::string &t
     if (useTransparency) {
         addShaderDefinition(USE_TRANSPARENCY_DEFINITION, "");
     }
-    if (wrapGrid) {
+    if (!pyramidMarch) {
+        addShaderDefinition(PYRAMID_MARCH_DEFINITION, "");
+    }
+    if (!wrapGrid) {
         addShaderDefinition(WRAP_GRID_DEFINITION, "");
     }
+    if (!tiledView) {
+        addShaderDefinition(TILED_VIEW_DEFINITION, "");
+    }
+    if (separableDiffusion) {
+        addShaderDefinition(SEPARABLE_DIFFUSION_DEFINITION, "");
+    }
     addShaderDefinition(SPORE_DEFINITION, "include/Spore.h");
+    addShaderDefinition(BRICK_TRACKING_DEFINITION, "shaders/common/brick_tracking.glsl");
+    addShaderDefinition(LINEAR_DISPATCH_DEFINITION, "shaders/common/linear_dispatch.glsl");
+    addShaderDefinition(VOXEL_FORMAT_DEFINITION, VOXEL_FORMATS[voxelFormat].definitionFile);
+    addShaderDefinition(VOXEL_ACCESS_DEFINITION, "shaders/common/voxel_access.glsl");
+    addShaderDefinition(SDF_SEED_DEFINITION, "shaders/common/sdf_seed.glsl");
+    addShaderDefinition(OCCUPANCY_DEFINITION, "shaders/common/occupancy.glsl");
+    addShaderDefinition(RAY_MARCH_DEFINITION, "shaders/common/ray_march.glsl");
+    if (!sparseGrid) {
+        addShaderDefinition(SPARSE_GRID_DEFINITION, "");
+    }
 
     // Set the simulation Settings to the Defaults
     assignDefaultsToSimulationData(simulationSettings,  static_cast<float>(getScreenWidth()) / static_cast<float>(getScreenHeight()));
@@ -55,16 +180,58 @@ MoldLabGame::~MoldLabGame() {
         glDeleteBuffers(1, &triangleVbo);
     if (triangleVao)
         glDeleteVertexArrays(1, &triangleVao);
-    if (sporesBuffer)
-        glDeleteBuffers(1, &sporesBuffer);
+    if (sporePositionsBuffer)
+        glDeleteBuffers(1, &sporePositionsBuffer);
+    if (sporeOrientationsBuffer)
+        glDeleteBuffers(1, &sporeOrientationsBuffer);
     if (simulationSettingsBuffer)
         glDeleteBuffers(1, &simulationSettingsBuffer);
+    if (activeBrickBuffer)
+        glDeleteBuffers(1, &activeBrickBuffer);
+    if (nextBrickBuffer)
+        glDeleteBuffers(1, &nextBrickBuffer);
+    if (brickStampBuffer)
+        glDeleteBuffers(1, &brickStampBuffer);
+    for (const GLuint buffer : {sortKeysBuffer, sortValuesBuffer, sortedKeysBuffer, sortedValuesBuffer, sortHistogramBuffer, sortedSporePositionsBuffer, sortedSporeOrientationsBuffer}) {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+    }
     if (voxelGridTexture)
         glDeleteTextures(1, &voxelGridTexture);
+    if (diffusedVoxelGridTexture)
+        glDeleteTextures(1, &diffusedVoxelGridTexture);
+    if (depositGridTexture)
+        glDeleteTextures(1, &depositGridTexture);
     if (sdfTexBuffer1)
         glDeleteTextures(1, &sdfTexBuffer1);
     if (sdfTexBuffer2)
         glDeleteTextures(1, &sdfTexBuffer2);
+    if (sdfTexBuffer3)
+        glDeleteTextures(1, &sdfTexBuffer3);
+    if (brickTableTexture)
+        glDeleteTextures(1, &brickTableTexture);
+    if (occupancyTexture)
+        glDeleteTextures(1, &occupancyTexture);
+    if (pyramidTexture)
+        glDeleteTextures(1, &pyramidTexture);
+    if (renderTargetTexture)
+        glDeleteTextures(1, &renderTargetTexture);
+    if (historyTexture1)
+        glDeleteTextures(1, &historyTexture1);
+    if (historyTexture2)
+        glDeleteTextures(1, &historyTexture2);
+    if (depthCacheTexture1)
+        glDeleteTextures(1, &depthCacheTexture1);
+    if (depthCacheTexture2)
+        glDeleteTextures(1, &depthCacheTexture2);
+    if (depthCacheFramebuffer)
+        glDeleteFramebuffers(1, &depthCacheFramebuffer);
+    if (coneDistanceTexture)
+        glDeleteTextures(1, &coneDistanceTexture);
+    if (renderTargetFramebuffer)
+        glDeleteFramebuffers(1, &renderTargetFramebuffer);
+    if (brickPoolBuffer)
+        glDeleteBuffers(1, &brickPoolBuffer);
 
     std::cout << "Exiting..." << std::endl;
 }
@@ -72,72 +239,244 @@ MoldLabGame::~MoldLabGame() {
 // ============================
 // Initialization Helpers
 // ============================
-void MoldLabGame::initializeRenderShader(bool useTransparency) {
-    if (!useTransparency) {
-        addShaderDefinition(USE_TRANSPARENCY_DEFINITION, "");
-    } else {
-        removeShaderDefinition(USE_TRANSPARENCY_DEFINITION);
+// Swaps a rebuilt program in, the one it replaces is deleted so rebuilding does not leak it
+void replaceProgram(GLuint &program, const GLuint rebuilt) {
+    if (program) {
+        glDeleteProgram(program);
     }
+    program = rebuilt;
+}
+
+void MoldLabGame::initializeRenderShader(bool useTransparency, bool pyramidMarch, bool tiledView, bool depthCache, bool conePrepass) {
+    setShaderDefinitionEnabled(USE_TRANSPARENCY_DEFINITION, useTransparency);
+
+    setShaderDefinitionEnabled(PYRAMID_MARCH_DEFINITION, pyramidMarch);
+
+    // Only the opaque SDF march can trace the repeating grid, the other two stop at its bounds
+    setShaderDefinitionEnabled(TILED_VIEW_DEFINITION, tiledView && !useTransparency && !pyramidMarch);
 
-    shaderProgram = CreateShaderProgram({
+    setShaderDefinitionEnabled(DEPTH_CACHE_DEFINITION, depthCache);
+
+    // The opaque pyramid ray march does not build the SDF the cones are marched against
+    setShaderDefinitionEnabled(CONE_PREPASS_DEFINITION, conePrepass && !(pyramidMarch && !useTransparency));
+
+    // The cached distances were measured by the previous ray march, which may see the trails differently
+    clearDepthCache();
+
+    replaceProgram(shaderProgram, CreateShaderProgram({
         {"shaders/renderer.glsl", GL_VERTEX_SHADER, true} // Combined vertex and fragment shaders
-    });
+    }));
+
+    // Same ray march, in 8x8 pixel tiles. The upscaling variant also keeps the hit distance for reprojection
+    replaceProgram(upscaledRenderTilesShaderProgram, CreateShaderProgram({
+        {"shaders/render_tiles.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    addShaderDefinition(TEMPORAL_UPSCALE_DEFINITION, "");
+    replaceProgram(renderTilesShaderProgram, CreateShaderProgram({
+        {"shaders/render_tiles.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(TEMPORAL_UPSCALE_DEFINITION);
+
+    replaceProgram(temporalUpscaleShaderProgram, CreateShaderProgram({
+        {"shaders/temporal_upscale.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(coneMarchShaderProgram, CreateShaderProgram({
+        {"shaders/cone_march.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    // The programs were replaced, so their uniforms have to be looked up again
+    checkerboardPhaseSV = ShaderVariable(upscaledRenderTilesShaderProgram, &checkerboardPhase, "checkerboardPhase");
+    historyValidSV = ShaderVariable(temporalUpscaleShaderProgram, &historyValid, "historyValid");
+    coneRenderSizeSV = ShaderVariable(coneMarchShaderProgram, &coneRenderSize, "renderSize");
 }
 
 void MoldLabGame::initializeMoveSporesShader(bool wrapAround) {
-    if (!wrapAround) {
-        addShaderDefinition(WRAP_GRID_DEFINITION, "");
-    } else {
-        removeShaderDefinition(WRAP_GRID_DEFINITION);
-    }
+    setShaderDefinitionEnabled(WRAP_GRID_DEFINITION, wrapAround);
+
+    // The separate move pass leaves depositing to draw_spores.glsl
+    addShaderDefinition(FUSED_DEPOSIT_DEFINITION, "");
+    replaceProgram(moveSporesShaderProgram, CreateShaderProgram({
+        {"shaders/move_spores.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(FUSED_DEPOSIT_DEFINITION);
 
-    moveSporesShaderProgram = CreateShaderProgram({
+    // Same source with the deposit folded in, so each spore is only read once per frame
+    replaceProgram(stepSporesShaderProgram, CreateShaderProgram({
         {"shaders/move_spores.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
 }
 
-void MoldLabGame::initializeShaders() {
-    initializeRenderShader(useTransparency);
+void MoldLabGame::initializeDepositShaders(bool atomicDeposit) {
+    setShaderDefinitionEnabled(ATOMIC_DEPOSIT_DEFINITION, atomicDeposit);
 
-    // Initialize the compute shaders
-    drawSporesShaderProgram = CreateShaderProgram({
+    replaceProgram(drawSporesShaderProgram, CreateShaderProgram({
         {"shaders/draw_spores.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
 
+    // The fused step deposits as well, so it has to follow the same mode
     initializeMoveSporesShader(wrapGrid);
+}
 
-    decaySporesShaderProgram = CreateShaderProgram({
-        {"shaders/decay_spores.glsl", GL_COMPUTE_SHADER, false}
-    });
+// Compiled with whatever WRAP_AROUND state the move shaders were last built with
+void MoldLabGame::initializeDiffusionShader(bool separableKernel) {
+    setShaderDefinitionEnabled(SEPARABLE_DIFFUSION_DEFINITION, separableKernel);
 
-    jumpFloodInitShaderProgram = CreateShaderProgram({
+    replaceProgram(decayDiffuseShaderProgram, CreateShaderProgram({
+        {"shaders/decay_diffuse.glsl", GL_COMPUTE_SHADER, false}
+    }));
+}
+
+// Periodic under WRAP_AROUND, so distances are measured across the faces the spores wrap through
+void MoldLabGame::initializeJumpFloodShaders() {
+    // Reseeds from the previous frame's SDF
+    replaceProgram(jumpFloodReseedShaderProgram, CreateShaderProgram({
         {"shaders/jump_flood_init.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
 
-    jumpFloodStepShaderProgram = CreateShaderProgram({
+    // Full rebuild variant, only looks at the trail grid
+    addShaderDefinition(TEMPORAL_JFA_DEFINITION, "");
+    replaceProgram(jumpFloodInitShaderProgram, CreateShaderProgram({
+        {"shaders/jump_flood_init.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(TEMPORAL_JFA_DEFINITION);
+
+    // Per-axis steps, 2 neighbours each instead of 26
+    replaceProgram(jumpFloodAxisStepShaderProgram, CreateShaderProgram({
         {"shaders/jump_flood_step.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
 
-    clearGridShaderProgram = CreateShaderProgram({
-    {"shaders/clear_grid.glsl", GL_COMPUTE_SHADER, false}
-    });
+    addShaderDefinition(SEPARABLE_JFA_DEFINITION, "");
+    replaceProgram(jumpFloodStepShaderProgram, CreateShaderProgram({
+        {"shaders/jump_flood_step.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(SEPARABLE_JFA_DEFINITION);
+
+    replaceProgram(compareSDFShaderProgram, CreateShaderProgram({
+        {"shaders/compare_sdf.glsl", GL_COMPUTE_SHADER, false}
+    }));
+}
+
+void MoldLabGame::initializeShaders() {
+    initializeGridShaders();
 
-    randomizeSporesShaderProgram = CreateShaderProgram({
+    replaceProgram(prepareBrickDispatchShaderProgram, CreateShaderProgram({
+    {"shaders/prepare_brick_dispatch.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    // Morton order radix sort
+    replaceProgram(mortonKeysShaderProgram, CreateShaderProgram({
+    {"shaders/morton_keys.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(radixCountShaderProgram, CreateShaderProgram({
+    {"shaders/radix_count.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(radixScanShaderProgram, CreateShaderProgram({
+    {"shaders/radix_scan.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(radixScatterShaderProgram, CreateShaderProgram({
+    {"shaders/radix_scatter.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(reorderSporesShaderProgram, CreateShaderProgram({
+    {"shaders/reorder_spores.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(randomizeSporesShaderProgram, CreateShaderProgram({
     {"shaders/randomize_spores.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
 
-    scaleSporesShaderProgram = CreateShaderProgram({
+    replaceProgram(scaleSporesShaderProgram, CreateShaderProgram({
     {"shaders/scale_spores.glsl", GL_COMPUTE_SHADER, false}
-    });
+    }));
+}
+
+// Every program that declares the trail grid's image format or storage, rebuilt when either changes
+void MoldLabGame::initializeGridShaders() {
+    initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+
+    // Initialize the compute shaders, the deposit shaders also build the move shaders
+    initializeDepositShaders(atomicDeposit);
+
+    replaceProgram(resolveDepositsShaderProgram, CreateShaderProgram({
+        {"shaders/resolve_deposits.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    initializeDiffusionShader(separableDiffusion);
+
+    replaceProgram(decaySporesShaderProgram, CreateShaderProgram({
+        {"shaders/decay_spores.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    replaceProgram(rebaseDecayClockShaderProgram, CreateShaderProgram({
+        {"shaders/rebase_decay_clock.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    // Only the seeding pass reads the grid, the rest of the jump flood is rebuilt along with it
+    initializeJumpFloodShaders();
+
+    replaceProgram(clearActiveBricksShaderProgram, CreateShaderProgram({
+    {"shaders/clear_grid.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    // Full grid variant, for when the grid contents are not tracked yet
+    addShaderDefinition(ACTIVE_BRICKS_ONLY_DEFINITION, "");
+    replaceProgram(clearGridShaderProgram, CreateShaderProgram({
+    {"shaders/clear_grid.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(ACTIVE_BRICKS_ONLY_DEFINITION);
+
+    // Base level of the trail pyramid from the grid, then each level from the one below
+    replaceProgram(buildPyramidBaseShaderProgram, CreateShaderProgram({
+    {"shaders/build_pyramid.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    addShaderDefinition(PYRAMID_BASE_DEFINITION, "");
+    replaceProgram(buildPyramidShaderProgram, CreateShaderProgram({
+    {"shaders/build_pyramid.glsl", GL_COMPUTE_SHADER, false}
+    }));
+    removeShaderDefinition(PYRAMID_BASE_DEFINITION);
+}
+
+// Only used by reallocateGrid(), which knows the storage of the grid being resampled from
+void MoldLabGame::initializeResampleShader(const bool sparseSource) {
+    static int sourceGridSize = simulationSettings.grid_size;
+    static int sourcePoolSide = 0;
+    static int allocateBricks = 0;
+
+    setShaderDefinitionEnabled(SPARSE_SOURCE_DEFINITION, sparseSource);
+    replaceProgram(resampleGridShaderProgram, CreateShaderProgram({
+    {"shaders/resample_grid.glsl", GL_COMPUTE_SHADER, false}
+    }));
+
+    sourceGridSizeSV = ShaderVariable(resampleGridShaderProgram, &sourceGridSize, "sourceGridSize");
+    if (sparseSource) {
+        sourcePoolSideSV = ShaderVariable(resampleGridShaderProgram, &sourcePoolSide, "sourcePoolSide");
+    }
+    if (sparseGrid) {
+        allocateBricksSV = ShaderVariable(resampleGridShaderProgram, &allocateBricks, "allocateBricks");
+    }
 }
 
 
 void MoldLabGame::initializeUniformVariables() {
     static int jfaStep = simulationSettings.grid_size;
+    static int jfaAxis = 0;
     static int maxSporeSize = SimulationDefaults::SPORE_COUNT;
+    static int sporeOffset = 0;
+    static int radixShift = 0;
 
     jfaStepSV = ShaderVariable(jumpFloodStepShaderProgram, &jfaStep, "stepSize");
+    jfaAxisStepSV = ShaderVariable(jumpFloodAxisStepShaderProgram, &jfaStep, "stepSize");
+    jfaAxisSV = ShaderVariable(jumpFloodAxisStepShaderProgram, &jfaAxis, "stepAxis");
     maxSporeSizeSV = ShaderVariable(scaleSporesShaderProgram, &maxSporeSize, "maxSporeSize");
+    sporeOffsetSV = ShaderVariable(randomizeSporesShaderProgram, &sporeOffset, "sporeOffset");
+    radixCountShiftSV = ShaderVariable(radixCountShaderProgram, &radixShift, "radixShift");
+    radixScatterShiftSV = ShaderVariable(radixScatterShaderProgram, &radixShift, "radixShift");
 }
 
 
@@ -156,219 +495,1469 @@ void MoldLabGame::initializeVertexBuffers() {
     glVertexAttribPointer(positionAttributeLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                           reinterpret_cast<void *>(offsetof(Vertex, position)));
 
-    glBindVertexArray(0); // Unbind VAO
-}
+    glBindVertexArray(0); // Unbind VAO
+}
+
+// Empties the error queue before an allocation, so the check after it only sees what the allocation raised.
+// Errors left by earlier calls are still reported, just not mistaken for the allocation's
+void clearGLErrors() {
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        std::cerr << "OpenGL error 0x" << std::hex << error << std::dec << " left before an allocation" << std::endl;
+    }
+}
+
+// True if the calls since clearGLErrors() ran out of memory, the whole queue is drained
+bool outOfMemory() {
+    bool outOfMemory = false;
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        outOfMemory = outOfMemory || error == GL_OUT_OF_MEMORY;
+    }
+    return outOfMemory;
+}
+
+// Returns 0 instead of a texture when the driver is out of memory
+GLuint createGridTexture(const GLenum internalFormat, const int sizeX, const int sizeY, const int sizeZ) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+
+    // Allocate storage for the 3D texture
+    clearGLErrors();
+    glTexStorage3D(GL_TEXTURE_3D, 1, internalFormat, sizeX, sizeY, sizeZ);
+
+    if (outOfMemory()) {
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+
+    // Set texture parameters
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_3D, 0); // Unbind the texture
+    return texture;
+}
+
+GLuint createGridTexture(const GLenum internalFormat, const int size) {
+    return createGridTexture(internalFormat, size, size, size);
+}
+
+GLuint createScreenTexture(const GLenum internalFormat, const int width, const int height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    clearGLErrors();
+    glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+
+    if (outOfMemory()) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// One bit per voxel of a grid of gridSize, zeroed as nothing is known to be occupied yet
+GLuint createOccupancyTexture(const int gridSize) {
+    const int sizeX = (gridSize + OCCUPANCY_WORD_SIZE_X - 1) / OCCUPANCY_WORD_SIZE_X;
+    const int sizeY = (gridSize + OCCUPANCY_WORD_SIZE_Y - 1) / OCCUPANCY_WORD_SIZE_Y;
+    const int sizeZ = (gridSize + OCCUPANCY_WORD_SIZE_Z - 1) / OCCUPANCY_WORD_SIZE_Z;
+
+    const GLuint texture = createGridTexture(GL_R32UI, sizeX, sizeY, sizeZ);
+    if (!texture) {
+        return 0;
+    }
+
+    glBindTexture(GL_TEXTURE_3D, texture);
+    const std::vector<GLuint> zeroSlice(static_cast<size_t>(sizeX) * sizeY, 0);
+    for (int z = 0; z < sizeZ; z++) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, sizeX, sizeY, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, zeroSlice.data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return texture;
+}
+
+// Sized to the current grid_size, reallocateGrid() reallocates it when that or the voxel format changes
+void MoldLabGame::initializeVoxelGridBuffer() {
+    allocatedGridSize = simulationSettings.grid_size;
+    allocatedVoxelFormat = voxelFormat;
+
+    // ** Create Voxel Grid Texture **
+    voxelGridTexture = createGridTexture(VOXEL_FORMATS[allocatedVoxelFormat].internalFormat, allocatedGridSize);
+    if (!voxelGridTexture) {
+        throw std::runtime_error("Out of memory allocating the voxel grid");
+    }
+
+    // Bind the texture as an image unit for compute shader access
+    glBindImageTexture(GRID_TEXTURE_LOCATION, voxelGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, VOXEL_FORMATS[allocatedVoxelFormat].internalFormat);
+
+    occupancyTexture = createOccupancyTexture(allocatedGridSize);
+    if (!occupancyTexture) {
+        throw std::runtime_error("Out of memory allocating the occupancy bitmask");
+    }
+    glBindImageTexture(OCCUPANCY_TEXTURE_LOCATION, occupancyTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+// Only allocated once atomic deposition is first enabled, as it is as large as the voxel grid
+bool MoldLabGame::initializeDepositGridBuffer() {
+    if (depositGridTexture) {
+        return true;
+    }
+
+    const int voxelGridSize = allocatedGridSize;
+
+    depositGridTexture = createGridTexture(GL_R32UI, voxelGridSize);
+    if (!depositGridTexture) {
+        return false;
+    }
+
+    // Start with nothing deposited, after that resolve_deposits.glsl zeroes what it consumes.
+    // Uploaded a slice at a time as glClearTexImage needs OpenGL 4.4
+    glBindTexture(GL_TEXTURE_3D, depositGridTexture);
+    const std::vector<GLuint> zeroSlice(static_cast<size_t>(voxelGridSize) * voxelGridSize, 0);
+    for (int z = 0; z < voxelGridSize; z++) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, voxelGridSize, voxelGridSize, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, zeroSlice.data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glBindImageTexture(DEPOSIT_TEXTURE_LOCATION, depositGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+    return true;
+}
+
+
+// Ping-pong target for decay_diffuse.glsl, only allocated once diffusion is first enabled
+bool MoldLabGame::initializeDiffusedVoxelGridBuffer() {
+    if (diffusedVoxelGridTexture) {
+        return true;
+    }
+
+    const GLenum internalFormat = VOXEL_FORMATS[allocatedVoxelFormat].internalFormat;
+    diffusedVoxelGridTexture = createGridTexture(internalFormat, allocatedGridSize);
+    if (!diffusedVoxelGridTexture) {
+        return false;
+    }
+
+    glBindImageTexture(GRID_TEXTURE_WRITE_LOCATION, diffusedVoxelGridTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, internalFormat);
+    return true;
+}
+
+
+// Only allocated once pyramid ray marching is first enabled, rebuilt from the grid every frame
+bool MoldLabGame::initializePyramidBuffer() {
+    if (pyramidTexture) {
+        return true;
+    }
+
+    // Padded so every level halves evenly, the top level still covers the whole grid
+    const int topCellSize = 1 << TRAIL_PYRAMID_LEVELS;
+    const int baseSize = (allocatedGridSize + topCellSize - 1) / topCellSize * (topCellSize / 2);
+
+    glGenTextures(1, &pyramidTexture);
+    glBindTexture(GL_TEXTURE_3D, pyramidTexture);
+    clearGLErrors();
+    glTexStorage3D(GL_TEXTURE_3D, TRAIL_PYRAMID_LEVELS, GL_R16F, baseSize, baseSize, baseSize);
+
+    if (outOfMemory()) {
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glDeleteTextures(1, &pyramidTexture);
+        pyramidTexture = 0;
+        return false;
+    }
+
+    // Only read with texelFetch, a mipmapped filter keeps every level accessible
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_LOCATION);
+    glBindTexture(GL_TEXTURE_3D, pyramidTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    pyramidBaseSize = baseSize;
+    return true;
+}
+
+
+// Image the compute renderer writes, bilinearly filtered for the upscaling pass
+bool MoldLabGame::initializeRenderTarget(const int width, const int height) {
+    if (renderTargetTexture) {
+        glDeleteTextures(1, &renderTargetTexture);
+    }
+    renderTargetWidth = 0;
+    renderTargetHeight = 0;
+
+    // Half floats, as the upscaling variant stores the hit distance in alpha
+    renderTargetTexture = createScreenTexture(GL_RGBA16F, width, height);
+    if (!renderTargetTexture) {
+        return false;
+    }
+
+    // Images are attached to it when they are blitted to the screen
+    if (!renderTargetFramebuffer) {
+        glGenFramebuffers(1, &renderTargetFramebuffer);
+    }
+
+    renderTargetWidth = width;
+    renderTargetHeight = height;
+    return true;
+}
+
+// Output of temporal_upscale.glsl at the screen resolution, each frame's output is the next frame's history
+bool MoldLabGame::initializeHistoryTextures(const int width, const int height) {
+    for (GLuint *historyTexture : {&historyTexture1, &historyTexture2}) {
+        if (*historyTexture) {
+            glDeleteTextures(1, historyTexture);
+        }
+        *historyTexture = createScreenTexture(GL_RGBA8, width, height);
+        if (!*historyTexture) {
+            historyWidth = 0;
+            historyHeight = 0;
+            return false;
+        }
+    }
+
+    historyWidth = width;
+    historyHeight = height;
+    historyValid = 0;
+    return true;
+}
+
+// Binds last frame's hit distances for reading and this frame's for writing, at the resolution being ray marched.
+// The two R32F images are swapped every frame, and reallocated and cleared when the resolution changes.
+// Out of memory turns the depth cache off, which rebuilds the render programs
+void MoldLabGame::bindDepthCache(const int width, const int height) {
+    if (!depthCache) {
+        return;
+    }
+
+    if (width != depthCacheWidth || height != depthCacheHeight) {
+        for (GLuint *depthCacheTexture : {&depthCacheTexture1, &depthCacheTexture2}) {
+            if (*depthCacheTexture) {
+                glDeleteTextures(1, depthCacheTexture);
+            }
+            *depthCacheTexture = createScreenTexture(GL_R32F, width, height);
+            if (!*depthCacheTexture) {
+                std::cerr << "Out of memory for the depth cache, rays start at the grid bounds again" << std::endl;
+                depthCacheWidth = 0;
+                depthCacheHeight = 0;
+                depthCache = false;
+                initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+                return;
+            }
+        }
+
+        if (!depthCacheFramebuffer) {
+            glGenFramebuffers(1, &depthCacheFramebuffer);
+        }
+        depthCacheWidth = width;
+        depthCacheHeight = height;
+        clearDepthCache();
+    } else {
+        // What was written last frame is read this frame
+        std::swap(depthCacheTexture1, depthCacheTexture2);
+    }
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT); // Last frame's distances were written as an image
+    glBindImageTexture(PREVIOUS_DEPTH_LOCATION, depthCacheTexture1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(DEPTH_CACHE_LOCATION, depthCacheTexture2, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+}
+
+// Marches one cone per 8x8 pixel block of the coming ray march against the SDF, so its rays can start where the
+// block's cone stopped. Out of memory turns the pre-pass off, which rebuilds the render programs
+void MoldLabGame::coneMarch(const int width, const int height) {
+    if (!conePrepass || (pyramidMarch && !useTransparency)) {
+        return;
+    }
+
+    const int blocksX = (width + CONE_BLOCK_SIZE - 1) / CONE_BLOCK_SIZE;
+    const int blocksY = (height + CONE_BLOCK_SIZE - 1) / CONE_BLOCK_SIZE;
+    if (blocksX != coneDistanceWidth || blocksY != coneDistanceHeight) {
+        if (coneDistanceTexture) {
+            glDeleteTextures(1, &coneDistanceTexture);
+        }
+        coneDistanceTexture = createScreenTexture(GL_R32F, blocksX, blocksY);
+        if (!coneDistanceTexture) {
+            std::cerr << "Out of memory for the cone distances, disabling the cone pre-pass" << std::endl;
+            coneDistanceWidth = 0;
+            coneDistanceHeight = 0;
+            conePrepass = false;
+            initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+            return;
+        }
+        coneDistanceWidth = blocksX;
+        coneDistanceHeight = blocksY;
+    }
+
+    glBindImageTexture(CONE_DISTANCE_LOCATION, coneDistanceTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+
+    coneRenderSize[0] = static_cast<float>(width);
+    coneRenderSize[1] = static_cast<float>(height);
+
+    glUseProgram(coneMarchShaderProgram);
+    coneRenderSizeSV.uploadToShader();
+    DispatchComputeShader(coneMarchShaderProgram, blocksX, blocksY, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+// Fills both depth images with -1, rays start at the grid bounds until a frame has been rendered again.
+// Needed whenever trails can appear anywhere rather than grow out of the ones already there
+void MoldLabGame::clearDepthCache() const {
+    if (!depthCacheFramebuffer) {
+        return;
+    }
+
+    const GLfloat noHit[] = {-1.0f, 0.0f, 0.0f, 0.0f};
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthCacheFramebuffer);
+    for (const GLuint depthCacheTexture : {depthCacheTexture1, depthCacheTexture2}) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthCacheTexture, 0);
+        glClearBufferfv(GL_COLOR, 0, noHit);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+// Rebuilt from scratch by executeJFA() every frame, so nothing has to be kept when reallocating
+bool MoldLabGame::initializeSDFBuffer() {
+    const int reducedGridSize = sdfGridSize();
+
+    for (GLuint *sdfTexture : {&sdfTexBuffer1, &sdfTexBuffer2, &sdfTexBuffer3}) {
+        if (*sdfTexture) {
+            glDeleteTextures(1, sdfTexture);
+            *sdfTexture = 0;
+        }
+
+        // The amortized build needs a texture of its own to ping-pong in, next to the finished SDF
+        if (sdfTexture == &sdfTexBuffer3 && !amortizedJFA) {
+            continue;
+        }
+
+        *sdfTexture = createGridTexture(SDF_INTERNAL_FORMAT, reducedGridSize);
+        if (!*sdfTexture) {
+            return false;
+        }
+    }
+
+    // Nothing for the temporal JFA to start from
+    sdfHistoryValid = false;
+    return true;
+}
+
+
+void uploadSettingsBuffer(GLuint &simulationSettingsBuffer, const SimulationData &settings) {
+    if (simulationSettingsBuffer == 0) {
+        glGenBuffers(1, &simulationSettingsBuffer);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulationSettingsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SimulationData), &settings, GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SIMULATION_BUFFER_LOCATION, simulationSettingsBuffer); // Binding index 2 for settings
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); // Unbind
+}
+
+void createStorageBuffer(GLuint &buffer, const GLsizeiptr size) {
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+    }
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MoldLabGame::initializeSimulationBuffers() {
+     sporeCapacity = simulationSettings.spore_count;
+     liveSporeCount = simulationSettings.spore_count; // Randomized by start()
+
+    // Positions and orientations live in separate buffers so passes only fetch what they use
+    createStorageBuffer(sporePositionsBuffer, sizeof(SporePosition) * sporeCapacity);
+    createStorageBuffer(sporeOrientationsBuffer, sizeof(SporeOrientation) * sporeCapacity);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_POSITION_BUFFER_LOCATION, sporePositionsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_ORIENTATION_BUFFER_LOCATION, sporeOrientationsBuffer);
+
+    // **Settings Buffer**
+    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+}
+
+void createBrickListBuffer(GLuint &buffer, const GLsizeiptr brickCount) {
+    createStorageBuffer(buffer, static_cast<GLsizeiptr>(sizeof(GLuint)) * (BRICK_LIST_HEADER_SIZE + brickCount));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+
+    // Only the header needs to start zeroed, entries past brick_count are never read
+    constexpr GLuint zero = 0;
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint) * BRICK_LIST_HEADER_SIZE, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Sized for every brick of a grid of gridSize, the lists and stamps of a previous grid are replaced
+void MoldLabGame::initializeBrickBuffers(const int gridSize) {
+    const GLsizeiptr bricksPerSide = (gridSize + BRICK_SIZE - 1) / BRICK_SIZE;
+    const GLsizeiptr brickCount = bricksPerSide * bricksPerSide * bricksPerSide;
+
+    createBrickListBuffer(activeBrickBuffer, brickCount);
+    createBrickListBuffer(nextBrickBuffer, brickCount);
+
+    createStorageBuffer(brickStampBuffer, static_cast<GLsizeiptr>(sizeof(GLuint)) * brickCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickStampBuffer);
+
+    constexpr GLuint zero = 0;
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_BRICK_BUFFER_LOCATION, activeBrickBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEXT_BRICK_BUFFER_LOCATION, nextBrickBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICK_STAMP_BUFFER_LOCATION, brickStampBuffer);
+}
+
+// Allocates a new buffer and copies the first keepSize bytes over on the GPU, the old buffer is kept if allocation fails
+bool reallocateStorageBuffer(GLuint &buffer, const GLsizeiptr size, const GLsizeiptr keepSize) {
+    GLuint resized;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+
+    clearGLErrors();
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+
+    if (outOfMemory()) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &resized);
+        return false;
+    }
+
+    if (buffer && keepSize > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = resized;
+    return true;
+}
+
+// Resizes the spore store without touching the first keepCount spores
+bool MoldLabGame::resizeSporeBuffers(const int capacity, const int keepCount) {
+    if (!reallocateStorageBuffer(sporePositionsBuffer, sizeof(SporePosition) * capacity, sizeof(SporePosition) * keepCount)) {
+        return false;
+    }
+    if (!reallocateStorageBuffer(sporeOrientationsBuffer, sizeof(SporeOrientation) * capacity, sizeof(SporeOrientation) * keepCount)) {
+        // Bring the positions back down to the capacity the orientations still have
+        reallocateStorageBuffer(sporePositionsBuffer, sizeof(SporePosition) * sporeCapacity, sizeof(SporePosition) * std::min(keepCount, sporeCapacity));
+        return false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_POSITION_BUFFER_LOCATION, sporePositionsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_ORIENTATION_BUFFER_LOCATION, sporeOrientationsBuffer);
+
+    sporeCapacity = capacity;
+
+    // Sort buffers only hold per-sort scratch data, so they are simply reallocated to match
+    if (sortCapacity > 0) {
+        initializeSortBuffers(sporeCapacity);
+    }
+    return true;
+}
+
+// Zeroes slices [firstZ, endZ) of a 3D texture, a slice at a time as glClearTexImage needs OpenGL 4.4
+void clearTextureSlices(const GLuint texture, const int width, const int height, const int firstZ, const int endZ, const GLenum format, const GLenum type) {
+    // Four bytes per texel covers both the float and the integer uploads
+    const std::vector<GLuint> zeroSlice(static_cast<size_t>(width) * height, 0);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    for (int z = firstZ; z < endZ; z++) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, width, height, 1, format, type, zeroSlice.data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+// Brick pool for the sparse grid, along with the brick table and free slot stack that index it. The pool is
+// sparse_pool_side bricks wide and high and starts out as deep, growBrickPool() adds layers of bricks behind it.
+// The table and stack replace the current ones without deleting them, so they can still be resampled from.
+// Returns the pool texture, or 0 when out of memory
+GLuint MoldLabGame::createSparseGrid(const GLenum internalFormat, const int gridSize) {
+    const int bricksPerSide = (gridSize + BRICK_SIZE - 1) / BRICK_SIZE;
+    const int totalBricks = bricksPerSide * bricksPerSide * bricksPerSide;
+    const int poolSide = std::max(1, static_cast<int>(std::ceil(std::cbrt(totalBricks * SPARSE_POOL_OCCUPANCY))));
+    const int poolBricks = poolSide * poolSide * poolSide;
+    const int poolSize = poolSide * BRICK_SIZE;
+
+    // Layers past the grid's brick count would never be handed out
+    GLint maxTextureSize;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    const int maxPoolLayers = std::min(maxTextureSize / BRICK_SIZE, (totalBricks + poolSide * poolSide - 1) / (poolSide * poolSide));
+
+    const GLuint table = createGridTexture(GL_R32UI, bricksPerSide);
+    if (!table) {
+        return 0;
+    }
+    const GLuint pool = createGridTexture(internalFormat, poolSize);
+    if (!pool) {
+        glDeleteTextures(1, &table);
+        return 0;
+    }
+
+    // No brick has a slot yet, and free slots are expected to be zero
+    clearTextureSlices(table, bricksPerSide, bricksPerSide, 0, bricksPerSide, GL_RED_INTEGER, GL_UNSIGNED_INT);
+    clearTextureSlices(pool, poolSize, poolSize, 0, poolSize, GL_RED, GL_FLOAT);
+
+    // Header followed by every slot
+    std::vector<GLuint> freeSlots(BRICK_POOL_HEADER_SIZE + poolBricks, 0);
+    freeSlots[0] = poolBricks;
+    std::iota(freeSlots.begin() + BRICK_POOL_HEADER_SIZE, freeSlots.end(), 0u);
+
+    GLuint freeSlotBuffer = 0;
+    createStorageBuffer(freeSlotBuffer, static_cast<GLsizeiptr>(sizeof(GLuint) * freeSlots.size()));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, freeSlotBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(sizeof(GLuint) * freeSlots.size()), freeSlots.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    brickPoolBuffer = freeSlotBuffer;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICK_POOL_BUFFER_LOCATION, brickPoolBuffer);
+    brickTableTexture = table;
+    glBindImageTexture(BRICK_TABLE_TEXTURE_LOCATION, brickTableTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+
+    simulationSettings.sparse_pool_side = poolSide;
+    sparsePoolLayers = poolSide;
+    sparsePoolMaxLayers = std::max(poolSide, maxPoolLayers);
+    sparsePoolFreeBricks = poolBricks;
+    sparsePoolDroppedBricks = 0;
+    return pool;
+}
+
+// Reads the brick pool's header back, which waits for the GPU to catch up, and grows the pool when it is running
+// low or bricks already found it empty. Returns whether the pool grew
+bool MoldLabGame::checkBrickPool() {
+    GLint header[BRICK_POOL_HEADER_SIZE];
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickPoolBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+
+    sparsePoolFreeBricks = header[0];
+    const int failedAllocations = header[1];
+    if (failedAllocations > 0) {
+        constexpr GLint zero = 0;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLint), sizeof(GLint), &zero);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    const int poolBricks = simulationSettings.sparse_pool_side * simulationSettings.sparse_pool_side * sparsePoolLayers;
+    if (failedAllocations == 0 && sparsePoolFreeBricks >= poolBricks * SPARSE_POOL_LOW_FRACTION) {
+        return false;
+    }
+    if (growBrickPool()) {
+        return true;
+    }
+
+    // Trails were dropped where those bricks would have been
+    sparsePoolDroppedBricks += failedAllocations;
+    return false;
+}
+
+// Doubles the layers of the brick pool, the bricks already handed out keep their slots
+bool MoldLabGame::growBrickPool() {
+    const int poolSide = simulationSettings.sparse_pool_side;
+    const int layers = std::min(sparsePoolLayers * 2, sparsePoolMaxLayers);
+    if (layers <= sparsePoolLayers) {
+        return false;
+    }
+
+    const GLenum internalFormat = VOXEL_FORMATS[allocatedVoxelFormat].internalFormat;
+    const int poolSize = poolSide * BRICK_SIZE;
+    const GLuint pool = createGridTexture(internalFormat, poolSize, poolSize, layers * BRICK_SIZE);
+
+    const int previousBricks = poolSide * poolSide * sparsePoolLayers;
+    const int poolBricks = poolSide * poolSide * layers;
+    if (!pool || !reallocateStorageBuffer(brickPoolBuffer, static_cast<GLsizeiptr>(sizeof(GLuint)) * (BRICK_POOL_HEADER_SIZE + poolBricks),
+                                          static_cast<GLsizeiptr>(sizeof(GLuint)) * (BRICK_POOL_HEADER_SIZE + previousBricks))) {
+        if (pool) {
+            glDeleteTextures(1, &pool);
+        }
+        std::cerr << "Out of memory growing the brick pool past " << previousBricks << " bricks" << std::endl;
+        sparsePoolMaxLayers = sparsePoolLayers;
+        return false;
+    }
+
+    // The new layers are free slots, which are expected to be zero
+    clearTextureSlices(pool, poolSize, poolSize, sparsePoolLayers * BRICK_SIZE, layers * BRICK_SIZE, GL_RED, GL_FLOAT);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glCopyImageSubData(voxelGridTexture, GL_TEXTURE_3D, 0, 0, 0, 0, pool, GL_TEXTURE_3D, 0, 0, 0, 0, poolSize, poolSize, sparsePoolLayers * BRICK_SIZE);
+
+    glDeleteTextures(1, &voxelGridTexture);
+    voxelGridTexture = pool;
+    glBindImageTexture(GRID_TEXTURE_LOCATION, voxelGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, internalFormat);
+
+    // Pushed on top of the slots that are still free, checkBrickPool() just read their count
+    std::vector<GLuint> addedSlots(poolBricks - previousBricks);
+    std::iota(addedSlots.begin(), addedSlots.end(), static_cast<GLuint>(previousBricks));
+    const GLint header[BRICK_POOL_HEADER_SIZE] = {sparsePoolFreeBricks + static_cast<GLint>(addedSlots.size()), 0};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickPoolBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(sizeof(GLuint)) * (BRICK_POOL_HEADER_SIZE + sparsePoolFreeBricks),
+                    static_cast<GLsizeiptr>(sizeof(GLuint) * addedSlots.size()), addedSlots.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICK_POOL_BUFFER_LOCATION, brickPoolBuffer);
+
+    sparsePoolLayers = layers;
+    sparsePoolFreeBricks = header[0];
+    return true;
+}
+
+// Only allocated once sorting is first enabled, the spore copy is as large as the spore buffer
+void MoldLabGame::initializeSortBuffers(const int capacity) {
+    const GLsizeiptr keysSize = sizeof(GLuint) * capacity;
+    const int blockCount = (capacity + RADIX_BLOCK_SIZE - 1) / RADIX_BLOCK_SIZE;
+
+    createStorageBuffer(sortKeysBuffer, keysSize);
+    createStorageBuffer(sortValuesBuffer, keysSize);
+    createStorageBuffer(sortedKeysBuffer, keysSize);
+    createStorageBuffer(sortedValuesBuffer, keysSize);
+    createStorageBuffer(sortHistogramBuffer, sizeof(GLuint) * RADIX * blockCount);
+    createStorageBuffer(sortedSporePositionsBuffer, sizeof(SporePosition) * capacity);
+    createStorageBuffer(sortedSporeOrientationsBuffer, sizeof(SporeOrientation) * capacity);
+
+    sortCapacity = capacity;
+}
+
+
+// ============================
+// Update Helpers
+// ============================
+void MoldLabGame::HandleCameraMovement(const float orbitRadius, const float deltaTime) {
+    static float angle = 0.0f; // Current angle of rotation
+
+    constexpr float rotationSpeed = 100.0f;
+
+    // Update the angle
+    angle += rotationSpeed * deltaTime;
+
+     float gridCenter = (static_cast<float>(simulationSettings.grid_size) - 1.0f) * 0.5f; // Adjust for the centered cube positions
+    set_vec4(simulationSettings.camera_focus, gridCenter, gridCenter, gridCenter, 0.0);
+
+    // Adjust horizontal angle
+    if (inputState.isLeftPressed) {
+        horizontalAngle += rotationSpeed * deltaTime;
+    }
+    if (inputState.isRightPressed) {
+        horizontalAngle -= rotationSpeed * deltaTime;
+    }
+
+    // Adjust vertical angle (clamped to avoid flipping)
+    if (inputState.isUpPressed) {
+        verticalAngle = std::min(verticalAngle + rotationSpeed * deltaTime, 89.0f);
+    }
+    if (inputState.isDownPressed) {
+        verticalAngle = std::max(verticalAngle - rotationSpeed * deltaTime, -89.0f);
+    }
+
+    // Ensure angles wrap around properly
+    if (horizontalAngle > 360.0f) horizontalAngle -= 360.0f;
+    if (horizontalAngle < 0.0f) horizontalAngle += 360.0f;
+    // Convert angles to radians
+    float azimuth = horizontalAngle * SimulationDefaults::PI / 180.0f; // Azimuth in radians
+    float altitude = verticalAngle * SimulationDefaults::PI / 180.0f; // Altitude in radians
+
+    // Compute camera position in spherical coordinates relative to the origin
+    float x = orbitRadius * cos(altitude) * sin(azimuth);
+    float y = orbitRadius * sin(altitude);
+    float z = orbitRadius * cos(altitude) * cos(azimuth);
+
+    // Get the focus point position
+    const vec4 &focusPoint = simulationSettings.camera_focus;
+
+    // Offset camera position by focus point
+    set_vec4(simulationSettings.camera_position, focusPoint[0] + x, focusPoint[1] + y, focusPoint[2] + z, 0.0);
+}
+
+// Only has to touch the bricks that still hold trail
+void MoldLabGame::clearGrid() const {
+    if (VOXEL_FORMATS[allocatedVoxelFormat].lazyDecay) {
+        // Without a decay pass the list only holds the bricks deposited into last frame
+        clearEntireGrid();
+    } else {
+        DispatchComputeShaderIndirect(clearActiveBricksShaderProgram, activeBrickBuffer);
+    }
+
+    // Nothing is listed anymore
+    constexpr GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeBrickBuffer);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint) * BRICK_LIST_HEADER_SIZE, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// For grid contents the brick lists know nothing about, like freshly allocated textures
+void MoldLabGame::clearEntireGrid() const {
+    const int gridSize = simulationSettings.grid_size;
+    DispatchComputeShader(clearGridShaderProgram, gridSize, gridSize, gridSize);
+}
+
+
+void MoldLabGame::randomizeSpores(const int firstSpore, const int count) const {
+    *sporeOffsetSV.value = firstSpore;
+
+    glUseProgram(randomizeSporesShaderProgram);
+    sporeOffsetSV.uploadToShader();
+    DispatchComputeShader(randomizeSporesShaderProgram, count, 1, 1);
+
+    // The new spores deposit trail anywhere, also in front of the cached hits
+    clearDepthCache();
+}
+
+
+void MoldLabGame::resetSporesAndGrid() const {
+    clearGrid();
+    randomizeSpores(0, simulationSettings.spore_count);
+}
+
+
+// Keeps the running spores when the count changes, only spores past the old count are randomized
+void MoldLabGame::updateSporeCount() {
+    const int sporeCount = simulationSettings.spore_count;
+    const int maxSporeCount = static_cast<int>(SimulationDefaults::MAX_SPORE_COUNT);
+
+    if (sporeCount > sporeCapacity) {
+        const int grownCapacity = std::min(std::max(sporeCount, sporeCapacity * SPORE_GROWTH_FACTOR), maxSporeCount);
+        if (!resizeSporeBuffers(grownCapacity, liveSporeCount) && !resizeSporeBuffers(sporeCount, liveSporeCount)) {
+            std::cerr << "Out of memory for " << sporeCount << " spores, keeping " << sporeCapacity << std::endl;
+            simulationSettings.spore_count = sporeCapacity;
+        }
+    } else if (sporeCount <= sporeCapacity / SPORE_SHRINK_RATIO) {
+        // Leave room to grow again so dragging the slider back and forth does not reallocate every frame
+        resizeSporeBuffers(sporeCount * SPORE_GROWTH_FACTOR, sporeCount);
+    }
+
+    if (simulationSettings.spore_count > liveSporeCount) {
+        uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+        randomizeSpores(liveSporeCount, simulationSettings.spore_count - liveSporeCount);
+    }
+    liveSporeCount = simulationSettings.spore_count;
+}
+
+
+void MoldLabGame::DispatchComputeShaders() {
+    if (simulationSettings.spore_count != liveSporeCount) {
+        updateSporeCount();
+    }
+
+    // Taken before this frame's JFA passes, which can only make the rendered SDF newer
+    simulationSettings.sdf_margin = sdfMargin();
+    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+
+    if (simulationSettings.grid_size == allocatedGridSize && voxelFormat == allocatedVoxelFormat && sparseGrid == allocatedSparseGrid) {
+        if (simulationSettings.simulation_time > SIMULATION_TIME_REBASE) {
+            rebaseSimulationTime();
+        }
+
+        if (sortSpores && simulationSettings.frame_index % sortInterval == 0) {
+            sortSporesByMortonCode();
+        }
+
+        simulationTimer.begin();
+
+        // Last frame's render passes used these image units for the depth cache
+        if (depositGridTexture) {
+            glBindImageTexture(DEPOSIT_TEXTURE_LOCATION, depositGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+        }
+        if (diffusedVoxelGridTexture) {
+            glBindImageTexture(GRID_TEXTURE_WRITE_LOCATION, diffusedVoxelGridTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, VOXEL_FORMATS[allocatedVoxelFormat].internalFormat);
+        }
+
+        // Lazily decayed voxels age on read, leaving nothing to do for the untouched ones
+        if (!VOXEL_FORMATS[allocatedVoxelFormat].lazyDecay) {
+            decayAndDiffuse();
+        }
+
+        // The sparse grid allocates bricks in the move pass, so the deposit has to be a separate dispatch
+        if (fuseSporeStep && !sparseGrid) {
+            DispatchComputeShader(stepSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+        } else {
+            DispatchComputeShader(moveSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+
+            DispatchComputeShader(drawSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+        }
+
+        finishBrickLists();
+
+        if (allocatedSparseGrid && simulationSettings.frame_index % SPARSE_POOL_CHECK_INTERVAL == 0) {
+            checkBrickPool();
+        }
+
+        if (atomicDeposit) {
+            // Everything deposited into this frame is in the list that was just finished
+            DispatchComputeShaderIndirect(resolveDepositsShaderProgram, activeBrickBuffer);
+        }
+
+        simulationTimer.end();
+    } else {
+        // The brick lists are rebuilt by the resample, so this frame does not step the spores
+        reallocateGrid();
+    }
+
+    simulationSettings.frame_index++;
+
+    if (pyramidMarch && !useTransparency) {
+        // The opaque renderer skips empty space with the pyramid, so the SDF is not needed
+        buildTrailPyramid();
+        sdfHistoryValid = false;
+    } else {
+        executeJFA();
+    }
+}
+
+// Brings simulation_time back to 0 along with everything stamped with it, as a float it would otherwise stop
+// resolving frames after a few days and lazily decayed trails would stop fading
+void MoldLabGame::rebaseSimulationTime() {
+    const float offset = simulationSettings.simulation_time;
+
+    if (VOXEL_FORMATS[allocatedVoxelFormat].lazyDecay) {
+        // Ages the voxels with the current clock, before it is reset below
+        const int gridSize = simulationSettings.grid_size;
+        DispatchComputeShader(rebaseDecayClockShaderProgram, gridSize, gridSize, gridSize);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    simulationSettings.simulation_time -= offset;
+    sdfBuildStartTime -= offset;
+    completedSDFStartTime -= offset;
+    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+}
+
+// Moves the simulation over to a grid of the new grid_size, voxel format or storage, trails are resampled and spores scaled on the GPU
+void MoldLabGame::reallocateGrid() {
+    const int previousGridSize = allocatedGridSize;
+    const int gridSize = simulationSettings.grid_size;
+    const VoxelFormat &format = VOXEL_FORMATS[voxelFormat];
+
+    // resample_grid.glsl decodes the old grid as the new format, so trails are dropped when switching to or from lazy decay
+    const bool resampleTrails = format.lazyDecay == VOXEL_FORMATS[allocatedVoxelFormat].lazyDecay;
+
+    // A new sparse grid replaces these, the old brick table and pool are still read by the resample
+    const GLuint sourceBrickTable = brickTableTexture;
+    const GLuint sourceBrickPoolBuffer = brickPoolBuffer;
+    const int sourcePoolSide = simulationSettings.sparse_pool_side;
+    const int sourcePoolLayers = sparsePoolLayers;
+    const int sourcePoolMaxLayers = sparsePoolMaxLayers;
+    const int sourcePoolFreeBricks = sparsePoolFreeBricks;
+    const int sourcePoolDroppedBricks = sparsePoolDroppedBricks;
+
+    // Starts out empty, the resample marks the trails it carries over
+    GLuint reallocatedOccupancyTexture = createOccupancyTexture(gridSize);
+
+    GLuint reallocatedGridTexture = 0;
+    if (reallocatedOccupancyTexture) {
+        reallocatedGridTexture = sparseGrid ? createSparseGrid(format.internalFormat, gridSize) : createGridTexture(format.internalFormat, gridSize);
+    }
+
+    // The SDF follows the grid size, so it is reallocated before the grid is replaced. Coarser reductions are tried
+    // before giving up on the new grid
+    if (reallocatedGridTexture) {
+        const int requestedReduction = simulationSettings.sdf_reduction;
+        bool sdfAllocated = false;
+        while (!sdfAllocated && simulationSettings.sdf_reduction <= SimulationDefaults::MAX_SDF_REDUCTION) {
+            sdfAllocated = initializeSDFBuffer();
+            if (!sdfAllocated) {
+                simulationSettings.sdf_reduction *= 2;
+            }
+        }
+
+        if (!sdfAllocated) {
+            simulationSettings.sdf_reduction = requestedReduction;
+            glDeleteTextures(1, &reallocatedGridTexture);
+            reallocatedGridTexture = 0;
+            if (sparseGrid) {
+                glDeleteTextures(1, &brickTableTexture);
+                glDeleteBuffers(1, &brickPoolBuffer);
+            }
+        } else if (simulationSettings.sdf_reduction != requestedReduction) {
+            std::cerr << "Out of memory for an SDF reduction of " << requestedReduction << ", using " << simulationSettings.sdf_reduction << std::endl;
+        }
+    }
+    if (!reallocatedGridTexture) {
+        // createSparseGrid() already switched the brick table and pool over
+        if (sparseGrid) {
+            brickTableTexture = sourceBrickTable;
+            brickPoolBuffer = sourceBrickPoolBuffer;
+            simulationSettings.sparse_pool_side = sourcePoolSide;
+            sparsePoolLayers = sourcePoolLayers;
+            sparsePoolMaxLayers = sourcePoolMaxLayers;
+            sparsePoolFreeBricks = sourcePoolFreeBricks;
+            sparsePoolDroppedBricks = sourcePoolDroppedBricks;
+            glBindImageTexture(BRICK_TABLE_TEXTURE_LOCATION, brickTableTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICK_POOL_BUFFER_LOCATION, brickPoolBuffer);
+        }
+        if (reallocatedOccupancyTexture) {
+            glDeleteTextures(1, &reallocatedOccupancyTexture);
+        }
+        std::cerr << "Out of memory for a " << format.name << " grid size of " << gridSize << ", keeping the current grid" << std::endl;
+
+        // Undo the scaling the grid size slider applied
+        const float revertFactor = static_cast<float>(previousGridSize) / static_cast<float>(gridSize);
+        simulationSettings.spore_speed *= revertFactor;
+        simulationSettings.sensor_distance *= revertFactor;
+        orbitRadius *= revertFactor;
+        simulationSettings.grid_size = previousGridSize;
+        voxelFormat = allocatedVoxelFormat;
+        sparseGrid = allocatedSparseGrid;
+        uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+
+        // A failed attempt at the new size may have released the current SDF
+        if (!initializeSDFBuffer()) {
+            throw std::runtime_error("Out of memory allocating the SDF");
+        }
+
+        // Switching to a sparse or lazily decayed grid turned atomic deposition off in the UI
+        initializeDepositShaders(atomicDeposit);
+        return;
+    }
+
+    // Every shader touching the grid declares its image format and storage, so those have to be rebuilt
+    if (voxelFormat != allocatedVoxelFormat || sparseGrid != allocatedSparseGrid) {
+        addShaderDefinition(VOXEL_FORMAT_DEFINITION, format.definitionFile);
+        setShaderDefinitionEnabled(SPARSE_GRID_DEFINITION, sparseGrid);
+        initializeGridShaders();
+        initializeUniformVariables();
+    }
+
+    // Bricks are listed in the new grid's coordinates from here on
+    if (gridSize != previousGridSize) {
+        initializeBrickBuffers(gridSize);
+    }
+
+    const bool sparseSource = allocatedSparseGrid;
+    allocatedGridSize = gridSize;
+    allocatedVoxelFormat = voxelFormat;
+    allocatedSparseGrid = sparseGrid;
+    simulationSettings.grid_resize_factor = static_cast<float>(gridSize) / static_cast<float>(previousGridSize);
+    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+
+    glDeleteTextures(1, &occupancyTexture);
+    occupancyTexture = reallocatedOccupancyTexture;
+    glBindImageTexture(OCCUPANCY_TEXTURE_LOCATION, occupancyTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+
+    const GLuint sourceGridTexture = voxelGridTexture;
+    voxelGridTexture = reallocatedGridTexture;
+    glBindImageTexture(GRID_TEXTURE_LOCATION, voxelGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, format.internalFormat);
+
+    if (resampleTrails) {
+        // Trail bricks are listed again in the new grid's coordinates as the resample pass writes them
+        initializeResampleShader(sparseSource);
+        glUseProgram(resampleGridShaderProgram);
+        *sourceGridSizeSV.value = previousGridSize;
+        sourceGridSizeSV.uploadToShader();
+
+        glActiveTexture(GL_TEXTURE0 + RESAMPLE_SOURCE_TEXTURE_LOCATION);
+        glBindTexture(GL_TEXTURE_3D, sourceGridTexture);
+        if (sparseSource) {
+            *sourcePoolSideSV.value = sourcePoolSide;
+            sourcePoolSideSV.uploadToShader();
+            glActiveTexture(GL_TEXTURE0 + RESAMPLE_SOURCE_TABLE_TEXTURE_LOCATION);
+            glBindTexture(GL_TEXTURE_3D, sourceBrickTable);
+        }
+
+        if (sparseGrid) {
+            // Every trail brick gets a slot before anything is stored, the pool grows until they all fit
+            *allocateBricksSV.value = 1;
+            allocateBricksSV.uploadToShader();
+            do {
+                DispatchComputeShader(resampleGridShaderProgram, gridSize, gridSize, gridSize);
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            } while (checkBrickPool());
+
+            *allocateBricksSV.value = 0;
+            allocateBricksSV.uploadToShader();
+        }
+        DispatchComputeShader(resampleGridShaderProgram, gridSize, gridSize, gridSize);
+
+        glActiveTexture(GL_TEXTURE0 + RESAMPLE_SOURCE_TABLE_TEXTURE_LOCATION);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glActiveTexture(GL_TEXTURE0 + RESAMPLE_SOURCE_TEXTURE_LOCATION);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    glDeleteTextures(1, &sourceGridTexture);
+    if (sparseSource) {
+        glDeleteTextures(1, &sourceBrickTable);
+        glDeleteBuffers(1, &sourceBrickPoolBuffer);
+        if (!sparseGrid) {
+            brickTableTexture = 0;
+            brickPoolBuffer = 0;
+        }
+    }
+
+    // A fresh sparse grid is already zeroed by createSparseGrid()
+    if (!resampleTrails && !sparseGrid) {
+        clearEntireGrid();
+    }
+
+    // Without a resample nothing was listed, so this empties the lists of the old grid's bricks
+    finishBrickLists();
+
+    if (gridSize != previousGridSize) {
+        *maxSporeSizeSV.value = simulationSettings.spore_count;
+
+        glUseProgram(scaleSporesShaderProgram);
+        maxSporeSizeSV.uploadToShader();
+        DispatchComputeShader(scaleSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+    }
+
+    // The other grids hold nothing worth keeping between frames, features whose grid no longer fits are switched off.
+    // The sparse grid does not support them, so they are released instead
+    if (sparseGrid) {
+        glDeleteTextures(1, &diffusedVoxelGridTexture);
+        glDeleteTextures(1, &depositGridTexture);
+        diffusedVoxelGridTexture = 0;
+        depositGridTexture = 0;
+    }
+    if (diffusedVoxelGridTexture) {
+        glDeleteTextures(1, &diffusedVoxelGridTexture);
+        diffusedVoxelGridTexture = 0;
+        if (!initializeDiffusedVoxelGridBuffer()) {
+            std::cerr << "Out of memory for the diffusion grid, disabling diffusion" << std::endl;
+            useDiffusion = false;
+        }
+    }
+    if (depositGridTexture) {
+        glDeleteTextures(1, &depositGridTexture);
+        depositGridTexture = 0;
+        if (!initializeDepositGridBuffer()) {
+            std::cerr << "Out of memory for the deposit grid, disabling atomic deposition" << std::endl;
+            atomicDeposit = false;
+            initializeDepositShaders(atomicDeposit);
+        }
+    }
+    if (pyramidTexture) {
+        glDeleteTextures(1, &pyramidTexture);
+        pyramidTexture = 0;
+        if (!initializePyramidBuffer()) {
+            std::cerr << "Out of memory for the trail pyramid, disabling pyramid ray marching" << std::endl;
+            pyramidMarch = false;
+            initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+        }
+    }
+
+    // Resampled trails moved with the grid
+    clearDepthCache();
+}
+
+// Reorders the spore buffer along a Morton curve, so spores that are close in space are also
+// close in dispatch order and sense/deposit into the same parts of the grid
+void MoldLabGame::sortSporesByMortonCode() {
+    const int sporeCount = simulationSettings.spore_count;
+
+    sortTimer.begin();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_HISTOGRAM_BUFFER_LOCATION, sortHistogramBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_KEYS_BUFFER_LOCATION, sortKeysBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_VALUES_BUFFER_LOCATION, sortValuesBuffer);
+
+    DispatchComputeShader(mortonKeysShaderProgram, sporeCount, 1, 1);
+
+    // Least significant digit first, each pass is a stable counting sort on 4 bits
+    for (int shift = 0; shift < MORTON_KEY_BITS; shift += RADIX_BITS) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_KEYS_BUFFER_LOCATION, sortKeysBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_VALUES_BUFFER_LOCATION, sortValuesBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORTED_KEYS_BUFFER_LOCATION, sortedKeysBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORTED_VALUES_BUFFER_LOCATION, sortedValuesBuffer);
+
+        *radixCountShiftSV.value = shift;
+
+        glUseProgram(radixCountShaderProgram);
+        radixCountShiftSV.uploadToShader();
+        DispatchComputeShader(radixCountShaderProgram, sporeCount, 1, 1);
 
-void MoldLabGame::initializeVoxelGridBuffer() {
-     int voxelGridSize = SimulationDefaults::MAX_GRID_SIZE;
+        DispatchComputeShader(radixScanShaderProgram, 1, 1, 1);
 
-    // ** Create Voxel Grid Texture **
-    glGenTextures(1, &voxelGridTexture);
-    glBindTexture(GL_TEXTURE_3D, voxelGridTexture);
+        glUseProgram(radixScatterShaderProgram);
+        radixScatterShiftSV.uploadToShader();
+        DispatchComputeShader(radixScatterShaderProgram, sporeCount, 1, 1);
 
-    // Allocate storage for the 3D texture
-    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R32F, voxelGridSize, voxelGridSize, voxelGridSize);
+        std::swap(sortKeysBuffer, sortedKeysBuffer);
+        std::swap(sortValuesBuffer, sortedValuesBuffer);
+    }
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Gather the spores into the spare buffer in sorted order, then make that the spore buffer
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORT_VALUES_BUFFER_LOCATION, sortValuesBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORTED_SPORE_POSITION_BUFFER_LOCATION, sortedSporePositionsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SORTED_SPORE_ORIENTATION_BUFFER_LOCATION, sortedSporeOrientationsBuffer);
+    DispatchComputeShader(reorderSporesShaderProgram, sporeCount, 1, 1);
 
-    // Bind the texture as an image unit for compute shader access
-    glBindImageTexture(GRID_TEXTURE_LOCATION, voxelGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32F);
+    std::swap(sporePositionsBuffer, sortedSporePositionsBuffer);
+    std::swap(sporeOrientationsBuffer, sortedSporeOrientationsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_POSITION_BUFFER_LOCATION, sporePositionsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_ORIENTATION_BUFFER_LOCATION, sporeOrientationsBuffer);
 
-    glBindTexture(GL_TEXTURE_3D, 0); // Unbind the texture
+    sortTimer.end();
 }
 
+// Max reduction of the trail grid, each level read from the one below it
+void MoldLabGame::buildTrailPyramid() const {
+    for (int level = 0; level < TRAIL_PYRAMID_LEVELS; level++) {
+        const int levelSize = pyramidBaseSize >> level;
 
-void MoldLabGame::initializeSDFBuffer() {
-     int reducedGridSize = simulationSettings.grid_size / simulationSettings.sdf_reduction;
-
-    glGenTextures(1, &sdfTexBuffer1);
-    glBindTexture(GL_TEXTURE_3D, sdfTexBuffer1);
-    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32F, reducedGridSize, reducedGridSize, reducedGridSize);
+        glBindImageTexture(PYRAMID_WRITE_LOCATION, pyramidTexture, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_R16F);
+        if (level > 0) {
+            glBindImageTexture(PYRAMID_READ_LOCATION, pyramidTexture, level - 1, GL_TRUE, 0, GL_READ_ONLY, GL_R16F);
+        }
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        DispatchComputeShader(level == 0 ? buildPyramidBaseShaderProgram : buildPyramidShaderProgram, levelSize, levelSize, levelSize);
 
-    glBindTexture(GL_TEXTURE_3D, 0);
+        // The next level loads this one as an image
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
 
-    glGenTextures(1, &sdfTexBuffer2);
-    glBindTexture(GL_TEXTURE_3D, sdfTexBuffer2);
-    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32F, reducedGridSize, reducedGridSize, reducedGridSize);
+    // The renderer samples the pyramid rather than loading it as an image
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, sdfTexBuffer1, 0, GL_TRUE, 0, GL_READ_ONLY, SDF_INTERNAL_FORMAT);
+}
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+// Turns this frame's list into next frame's active list, and empties the old one to be refilled
+void MoldLabGame::finishBrickLists() {
+    DispatchComputeShader(prepareBrickDispatchShaderProgram, 1, 1, 1);
 
-    glBindTexture(GL_TEXTURE_3D, 0);
+    std::swap(activeBrickBuffer, nextBrickBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_BRICK_BUFFER_LOCATION, activeBrickBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEXT_BRICK_BUFFER_LOCATION, nextBrickBuffer);
 }
 
+void MoldLabGame::decayAndDiffuse() {
+    int gridSize = simulationSettings.grid_size;
 
-void uploadSettingsBuffer(GLuint &simulationSettingsBuffer, const SimulationData &settings) {
-    if (simulationSettingsBuffer == 0) {
-        glGenBuffers(1, &simulationSettingsBuffer);
+    if (!useDiffusion) {
+        // Only bricks that still hold trail need decaying
+        DispatchComputeShaderIndirect(decaySporesShaderProgram, activeBrickBuffer);
+        return;
     }
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulationSettingsBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SimulationData), &settings, GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SIMULATION_BUFFER_LOCATION, simulationSettingsBuffer); // Binding index 2 for settings
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); // Unbind
+    // Tiles need their neighbours' old values, so write into the other grid and swap
+    DispatchComputeShader(decayDiffuseShaderProgram, gridSize, gridSize, gridSize);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    std::swap(voxelGridTexture, diffusedVoxelGridTexture);
+    const GLenum internalFormat = VOXEL_FORMATS[allocatedVoxelFormat].internalFormat;
+    glBindImageTexture(GRID_TEXTURE_LOCATION, voxelGridTexture, 0, GL_TRUE, 0, GL_READ_WRITE, internalFormat);
+    glBindImageTexture(GRID_TEXTURE_WRITE_LOCATION, diffusedVoxelGridTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, internalFormat);
 }
 
-void MoldLabGame::initializeSimulationBuffers() {
-     GLsizeiptr sporesSize = sizeof(Spore) * simulationSettings.spore_count;
+// Builds the SDF from the trail grid. The temporal mode starts from last frame's SDF instead and only runs
+// the smallest steps, as trails barely move between frames. A periodic full rebuild bounds the error it collects
+void MoldLabGame::executeJFA() {
+    jfaTimer.begin();
 
+    if (amortizedJFA && sdfHistoryValid) {
+        amortizedJumpFlood();
+    } else {
+        const bool rebuild = !temporalJFA || !sdfHistoryValid || framesSinceSDFRebuild >= jfaRebuildInterval;
+        jumpFlood(rebuild, separableJFA);
 
-    glGenBuffers(1, &sporesBuffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sporesBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sporesSize, nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPORE_BUFFER_LOCATION, sporesBuffer); // Binding index 1 for spores
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); // Unbind
+        framesSinceSDFRebuild = rebuild ? 0 : framesSinceSDFRebuild + 1;
 
-    // **Settings Buffer**
-    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+        // A complete SDF of this frame, the amortized builds start over from here
+        completedSDFStartTime = simulationSettings.simulation_time;
+        completedSDFStartFrame = simulationSettings.frame_index;
+        amortizedJFAPass = 0;
+    }
+    sdfHistoryValid = true;
+
+    jfaTimer.end();
 }
 
+// Leaves the SDF in sdfTexBuffer1, bound for reading by the renderer
+void MoldLabGame::jumpFlood(const bool rebuild, const bool separable) {
+    // sdfTexBuffer1 holds last frame's result, the reseed reads it while writing the other texture
+    dispatchJFAPass(rebuild ? jumpFloodInitShaderProgram : jumpFloodReseedShaderProgram, sdfTexBuffer1, sdfTexBuffer2);
 
-// ============================
-// Update Helpers
-// ============================
-void MoldLabGame::HandleCameraMovement(const float orbitRadius, const float deltaTime) {
-    static float angle = 0.0f; // Current angle of rotation
+    GLuint readTexture = sdfTexBuffer2;
+    GLuint writeTexture = sdfTexBuffer1;
 
-    constexpr float rotationSpeed = 100.0f;
+    const int firstStepSize = rebuild ? firstJFAStepSize() : 1 << (temporalJFAPasses - 1);
 
-    // Update the angle
-    angle += rotationSpeed * deltaTime;
+    const auto stepPass = [&](const GLuint program) {
+        dispatchJFAPass(program, readTexture, writeTexture);
+        std::swap(readTexture, writeTexture);
+    };
 
-     float gridCenter = (static_cast<float>(simulationSettings.grid_size) - 1.0f) * 0.5f; // Adjust for the centered cube positions
-    set_vec4(simulationSettings.camera_focus, gridCenter, gridCenter, gridCenter, 0.0);
+    if (separable) {
+        glUseProgram(jumpFloodAxisStepShaderProgram);
 
-    // Adjust horizontal angle
-    if (inputState.isLeftPressed) {
-        horizontalAngle += rotationSpeed * deltaTime;
+        // Each axis is flooded completely before the next one, so the cheaper passes lose as little accuracy as possible
+        for (int axis = 0; axis < 3; axis++) {
+            *jfaAxisSV.value = axis;
+            jfaAxisSV.uploadToShader();
+
+            for (int stepSize = firstStepSize; stepSize >= 1; stepSize /= 2) {
+                *jfaAxisStepSV.value = stepSize;
+                jfaAxisStepSV.uploadToShader();
+                stepPass(jumpFloodAxisStepShaderProgram);
+            }
+        }
+    } else {
+        glUseProgram(jumpFloodStepShaderProgram);
+
+        for (int stepSize = firstStepSize; stepSize >= 1; stepSize /= 2) {
+            *jfaStepSV.value = stepSize;
+            jfaStepSV.uploadToShader();
+            stepPass(jumpFloodStepShaderProgram);
+        }
     }
-    if (inputState.isRightPressed) {
-        horizontalAngle -= rotationSpeed * deltaTime;
+
+    // Keep the result in sdfTexBuffer1 for the next reseed
+    if (readTexture != sdfTexBuffer1) {
+        std::swap(sdfTexBuffer1, sdfTexBuffer2);
     }
 
-    // Adjust vertical angle (clamped to avoid flipping)
-    if (inputState.isUpPressed) {
-        verticalAngle = std::min(verticalAngle + rotationSpeed * deltaTime, 89.0f);
+    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, sdfTexBuffer1, 0, GL_TRUE, 0, GL_READ_ONLY, SDF_INTERNAL_FORMAT);
+    // set to read after last swap for rendering
+}
+
+// Runs the next few passes of a full rebuild, ping-ponging between sdfTexBuffer2 and 3. The renderer keeps
+// reading the finished SDF in sdfTexBuffer1 until the build completes and takes its place
+void MoldLabGame::amortizedJumpFlood() {
+    if (amortizedJFAPass == 0) {
+        amortizedJFASeparable = separableJFA;
     }
-    if (inputState.isDownPressed) {
-        verticalAngle = std::max(verticalAngle - rotationSpeed * deltaTime, -89.0f);
+
+    const int firstStepSize = firstJFAStepSize();
+    int stepsPerAxis = 0;
+    for (int stepSize = firstStepSize; stepSize >= 1; stepSize /= 2) {
+        stepsPerAxis++;
     }
+    const int passCount = 1 + stepsPerAxis * (amortizedJFASeparable ? 3 : 1);
 
-    // Ensure angles wrap around properly
-    if (horizontalAngle > 360.0f) horizontalAngle -= 360.0f;
-    if (horizontalAngle < 0.0f) horizontalAngle += 360.0f;
-    // Convert angles to radians
-    float azimuth = horizontalAngle * SimulationDefaults::PI / 180.0f; // Azimuth in radians
-    float altitude = verticalAngle * SimulationDefaults::PI / 180.0f; // Altitude in radians
+    if (amortizedJFAPass == 0) {
+        // Fit as many passes into the budget as the last measured frame suggests, the timer covers all of its passes
+        if (jfaTimer.hasResult()) {
+            const float passTime = std::max(jfaTimer.getMilliseconds() / static_cast<float>(amortizedJFAPassesPerFrame), 0.001f);
+            amortizedJFAPassesPerFrame = std::clamp(static_cast<int>(SimulationDefaults::AMORTIZED_JFA_BUDGET / passTime), 1, passCount);
+        }
+        amortizedJFAFrames = (passCount + amortizedJFAPassesPerFrame - 1) / amortizedJFAPassesPerFrame;
+    }
 
-    // Compute camera position in spherical coordinates relative to the origin
-    float x = orbitRadius * cos(altitude) * sin(azimuth);
-    float y = orbitRadius * sin(altitude);
-    float z = orbitRadius * cos(altitude) * cos(azimuth);
+    for (int pass = 0; pass < amortizedJFAPassesPerFrame && amortizedJFAPass < passCount; pass++, amortizedJFAPass++) {
+        if (amortizedJFAPass == 0) {
+            sdfBuildStartTime = simulationSettings.simulation_time;
+            sdfBuildStartFrame = simulationSettings.frame_index;
 
-    // Get the focus point position
-    const vec4 &focusPoint = simulationSettings.camera_focus;
+            // The full init pass never reads the previous SDF
+            dispatchJFAPass(jumpFloodInitShaderProgram, sdfTexBuffer3, sdfTexBuffer2);
+            continue;
+        }
 
-    // Offset camera position by focus point
-    set_vec4(simulationSettings.camera_position, focusPoint[0] + x, focusPoint[1] + y, focusPoint[2] + z, 0.0);
-}
+        // Same order as jumpFlood(), axis-major when separable
+        const int stepIndex = amortizedJFAPass - 1;
+        const int stepSize = firstStepSize >> (stepIndex % stepsPerAxis);
+        if (amortizedJFASeparable) {
+            glUseProgram(jumpFloodAxisStepShaderProgram);
+            *jfaAxisSV.value = stepIndex / stepsPerAxis;
+            jfaAxisSV.uploadToShader();
+            *jfaAxisStepSV.value = stepSize;
+            jfaAxisStepSV.uploadToShader();
+            dispatchJFAPass(jumpFloodAxisStepShaderProgram, sdfTexBuffer2, sdfTexBuffer3);
+        } else {
+            glUseProgram(jumpFloodStepShaderProgram);
+            *jfaStepSV.value = stepSize;
+            jfaStepSV.uploadToShader();
+            dispatchJFAPass(jumpFloodStepShaderProgram, sdfTexBuffer2, sdfTexBuffer3);
+        }
 
-void MoldLabGame::clearGrid() const {
-    const int gridSize = simulationSettings.grid_size;
-    DispatchComputeShader(clearGridShaderProgram, gridSize, gridSize, gridSize);
-}
+        // The newest partial SDF always ends up in sdfTexBuffer2
+        std::swap(sdfTexBuffer2, sdfTexBuffer3);
+    }
 
+    if (amortizedJFAPass == passCount) {
+        std::swap(sdfTexBuffer1, sdfTexBuffer2);
+        completedSDFStartTime = sdfBuildStartTime;
+        completedSDFStartFrame = sdfBuildStartFrame;
+        amortizedJFAPass = 0;
+    }
 
-void MoldLabGame::resetSporesAndGrid() const {
-    clearGrid();
-    DispatchComputeShader(randomizeSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, sdfTexBuffer1, 0, GL_TRUE, 0, GL_READ_ONLY, SDF_INTERNAL_FORMAT);
 }
 
+void MoldLabGame::dispatchJFAPass(const GLuint program, const GLuint readTexture, const GLuint writeTexture) const {
+    const int reducedGridSize = sdfGridSize();
 
-void MoldLabGame::DispatchComputeShaders() {
-    int gridSize = simulationSettings.grid_size;
+    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, readTexture, 0, GL_TRUE, 0, GL_READ_ONLY, SDF_INTERNAL_FORMAT);
+    glBindImageTexture(SDF_TEXTURE_WRITE_LOCATION, writeTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, SDF_INTERNAL_FORMAT);
 
-    uploadSettingsBuffer(simulationSettingsBuffer, simulationSettings);
+    DispatchComputeShader(program, reducedGridSize, reducedGridSize, reducedGridSize);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
 
-    if (!gridSizeChanged) {
-        DispatchComputeShader(decaySporesShaderProgram, gridSize, gridSize, gridSize);
+// Largest power of 2 below the reduced grid size, a full rebuild halves it down to 1
+int MoldLabGame::firstJFAStepSize() const {
+    const int reducedGridSize = sdfGridSize();
+    int firstStepSize = 1;
+    while (firstStepSize * 2 < reducedGridSize) {
+        firstStepSize *= 2;
+    }
+    return firstStepSize;
+}
 
-        DispatchComputeShader(moveSporesShaderProgram, simulationSettings.spore_count, 1, 1);
+// An SDF seeded a while ago misses the trail laid since. Every spore deposits where it is, so new trail is
+// at most as far from an old seed as the spores moved, plus a voxel per diffusion pass
+float MoldLabGame::sdfMargin() const {
+    if (!amortizedJFA) {
+        return 0.0f;
+    }
 
-        DispatchComputeShader(drawSporesShaderProgram, simulationSettings.spore_count, 1, 1);
-    } else {
-        resetSporesAndGrid();
+    const float elapsed = simulationSettings.simulation_time - completedSDFStartTime;
+    float margin = simulationSettings.spore_speed * elapsed;
+    if (useDiffusion) {
+        margin += static_cast<float>(simulationSettings.frame_index - completedSDFStartFrame);
     }
+    return margin;
+}
+
+// Rounded up like sdfGridSize() in sdf_seed.glsl, the last cell only partly covers the grid
+int MoldLabGame::sdfGridSize() const {
+    return (simulationSettings.grid_size + simulationSettings.sdf_reduction - 1) / simulationSettings.sdf_reduction;
+}
 
-    gridSizeChanged = false;
+// The SDF is rebuilt every frame, so switching only costs the reallocation
+void MoldLabGame::setSDFReduction(const int reduction) {
+    const int previousReduction = simulationSettings.sdf_reduction;
+    simulationSettings.sdf_reduction = reduction;
+    if (initializeSDFBuffer()) {
+        return;
+    }
 
-    executeJFA();
+    std::cerr << "Out of memory for an SDF reduction of " << reduction << ", keeping " << previousReduction << std::endl;
+    simulationSettings.sdf_reduction = previousReduction;
+    if (!initializeSDFBuffer()) {
+        throw std::runtime_error("Out of memory allocating the SDF");
+    }
 }
 
-void MoldLabGame::executeJFA() const {
-    glUseProgram(jumpFloodInitShaderProgram);
+// Every few seconds, coarsens the SDF when the measured GPU frame is over budget, and refines it when the
+// jump flood at the finer reduction would still fit. Halving the reduction makes the jump flood about 8x as expensive
+void MoldLabGame::adaptSDFReduction(const float deltaTime) {
+    sdfAdaptElapsed += deltaTime;
+    if (sdfAdaptElapsed < SimulationDefaults::SDF_ADAPT_INTERVAL) {
+        return;
+    }
+    sdfAdaptElapsed = 0.0f;
 
-    GLuint readTexture = sdfTexBuffer1;
-    GLuint writeTexture = sdfTexBuffer2; // will be used later
+    // The pyramid ray march does not build the SDF, so there is nothing to trade
+    if ((pyramidMarch && !useTransparency) || !simulationTimer.hasResult() || !jfaTimer.hasResult() || !renderTimer.hasResult()) {
+        return;
+    }
 
-    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, readTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F); // set it to write ONLY for initialization
+    const float jfaTime = jfaTimer.getMilliseconds();
+    const float frameTime = simulationTimer.getMilliseconds() + jfaTime + renderTimer.getMilliseconds();
+    const int reduction = simulationSettings.sdf_reduction;
 
+    if (frameTime > targetFrameTime && reduction < SimulationDefaults::MAX_SDF_REDUCTION) {
+        setSDFReduction(reduction * 2);
+    } else if (reduction > 1 && frameTime + jfaTime * 7.0f < targetFrameTime) {
+        setSDFReduction(reduction / 2);
+    }
+}
 
-     int reducedGridSize = simulationSettings.grid_size / simulationSettings.sdf_reduction;
-    DispatchComputeShader(jumpFloodInitShaderProgram, reducedGridSize, reducedGridSize, reducedGridSize);
-    // inits the read, for later use
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+// Every frame, moves the internal render resolution towards the target frame time. The ray march costs about as much
+// as it has pixels, so the scale follows the square root of the render pass budget over its measured time. Between the
+// hysteresis fraction of the target and the target itself the scale is left alone, so it does not flip back and forth
+void MoldLabGame::adaptRenderScale() {
+    if (renderScaleSettleFrames > 0) {
+        renderScaleSettleFrames--;
+        return;
+    }
+    if (!simulationTimer.hasResult() || !jfaTimer.hasResult() || !renderTimer.hasResult()) {
+        return;
+    }
+
+    const float renderTime = renderTimer.getMilliseconds();
+    const float frameTime = simulationTimer.getMilliseconds() + jfaTimer.getMilliseconds() + renderTime;
+    if (frameTime <= targetFrameTime && frameTime >= targetFrameTime * SimulationDefaults::RENDER_SCALE_HYSTERESIS) {
+        return;
+    }
 
+    // Aim for the middle of the band, with whatever the simulation leaves of it for the render pass
+    const float aimedFrameTime = targetFrameTime * (1.0f + SimulationDefaults::RENDER_SCALE_HYSTERESIS) / 2.0f;
+    const float renderBudget = std::max(aimedFrameTime - (frameTime - renderTime), 0.0f);
 
-    glUseProgram(jumpFloodStepShaderProgram);
+    float scale = renderScale * std::sqrt(renderBudget / std::max(renderTime, 0.01f));
+    scale = std::clamp(scale, renderScale - SimulationDefaults::RENDER_SCALE_STEP, renderScale + SimulationDefaults::RENDER_SCALE_STEP);
+    scale = std::round(scale / SimulationDefaults::RENDER_SCALE_INCREMENT) * SimulationDefaults::RENDER_SCALE_INCREMENT;
+    scale = std::clamp(scale, SimulationDefaults::MIN_RENDER_SCALE, 1.0f);
 
-    // Start with the largest power of 2 that's less than or equal to reducedGridSize
-    int stepSize = 1;
-    while (stepSize * 2 < reducedGridSize) {
-        stepSize *= 2;
+    if (std::abs(scale - renderScale) > SimulationDefaults::RENDER_SCALE_INCREMENT / 2.0f) {
+        renderScale = scale;
+        renderScaleSettleFrames = SimulationDefaults::RENDER_SCALE_SETTLE_FRAMES;
     }
+}
 
-    int iterations = 0;
-    int testStopping = 1;
+// Fully rebuilds the SDF with both jump floods and measures how far the separable one is from the 26 neighbour one
+void MoldLabGame::compareSDFBuilders() {
+    const int reducedGridSize = sdfGridSize();
 
-    while (stepSize >= 1) {
-        iterations++;
-        glBindImageTexture(SDF_TEXTURE_READ_LOCATION, readTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32F);
-        glBindImageTexture(SDF_TEXTURE_WRITE_LOCATION, writeTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    const GLuint referenceTexture = createGridTexture(SDF_INTERNAL_FORMAT, reducedGridSize);
+    if (!referenceTexture) {
+        std::cerr << "Out of memory for the reference SDF, skipping the comparison" << std::endl;
+        return;
+    }
 
+    jumpFlood(true, false);
+    glCopyImageSubData(sdfTexBuffer1, GL_TEXTURE_3D, 0, 0, 0, 0, referenceTexture, GL_TEXTURE_3D, 0, 0, 0, 0, reducedGridSize, reducedGridSize, reducedGridSize);
+    jumpFlood(true, true);
 
-        *jfaStepSV.value = stepSize;
-        jfaStepSV.uploadToShader();
+    // Both builds went through sdfTexBuffer2, so an amortized build in progress has to start over
+    amortizedJFAPass = 0;
 
+    // Matches the SDFError struct in compare_sdf.glsl
+    struct SDFError {
+        float errorSum;
+        float maxError;
+        GLuint mismatches;
+    };
 
-        DispatchComputeShader(jumpFloodStepShaderProgram, reducedGridSize, reducedGridSize, reducedGridSize);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-        stepSize /= 2; // Halve step size
-        std::swap(readTexture, writeTexture);
+    const int workgroupsPerSide = (reducedGridSize + 7) / 8; // compare_sdf.glsl runs 8^3 workgroups
+    std::vector<SDFError> workgroupErrors(static_cast<size_t>(workgroupsPerSide) * workgroupsPerSide * workgroupsPerSide);
 
-        if (iterations == testStopping) {
-            // break;
-        }
+    GLuint errorBuffer = 0;
+    createStorageBuffer(errorBuffer, static_cast<GLsizeiptr>(workgroupErrors.size() * sizeof(SDFError)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SDF_ERROR_BUFFER_LOCATION, errorBuffer);
+    glBindImageTexture(SDF_TEXTURE_WRITE_LOCATION, referenceTexture, 0, GL_TRUE, 0, GL_READ_ONLY, SDF_INTERNAL_FORMAT);
+
+    DispatchComputeShader(compareSDFShaderProgram, reducedGridSize, reducedGridSize, reducedGridSize);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, errorBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(workgroupErrors.size() * sizeof(SDFError)), workgroupErrors.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glDeleteBuffers(1, &errorBuffer);
+    glDeleteTextures(1, &referenceTexture);
+
+    double errorSum = 0.0;
+    sdfComparison = {};
+    for (const SDFError &error : workgroupErrors) {
+        errorSum += error.errorSum;
+        sdfComparison.maxError = std::max(sdfComparison.maxError, error.maxError);
+        sdfComparison.mismatchedCells += error.mismatches;
     }
+    const double cellCount = static_cast<double>(reducedGridSize) * reducedGridSize * reducedGridSize;
+    sdfComparison.meanError = static_cast<float>(errorSum / cellCount);
+    sdfComparison.mismatchFraction = static_cast<float>(sdfComparison.mismatchedCells / cellCount);
+    sdfComparison.measured = true;
 
-    glBindImageTexture(SDF_TEXTURE_READ_LOCATION, readTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32F);
-    // set to read after last swap for rendering
+    std::cout << "Separable JFA vs 26 neighbour JFA: mean error " << sdfComparison.meanError << ", max error " << sdfComparison.maxError
+              << ", " << sdfComparison.mismatchedCells << " mismatched cells (" << sdfComparison.mismatchFraction * 100.0f << "%)" << std::endl;
 }
 
 
@@ -385,11 +1974,15 @@ void MoldLabGame::renderingStart() {
 
     initializeVoxelGridBuffer();
 
-    initializeSDFBuffer();
+    if (!initializeSDFBuffer()) {
+        throw std::runtime_error("Out of memory allocating the SDF");
+    }
 
     // initializeSpores();
 
     initializeSimulationBuffers();
+
+    initializeBrickBuffers(allocatedGridSize);
 }
 
 void MoldLabGame::start() {
@@ -406,6 +1999,8 @@ void MoldLabGame::start() {
     inputManager.bindKeyState(GLFW_KEY_DOWN, &inputState.isDownPressed);
 
 
+    // The grid starts out with undefined contents that no brick list knows about
+    clearEntireGrid();
     resetSporesAndGrid();
 }
 
@@ -413,6 +2008,17 @@ void MoldLabGame::update(float deltaTime) {
     HandleCameraMovement(orbitRadius, deltaTime);
 
     simulationSettings.delta_time = deltaTime;
+    simulationSettings.simulation_time += deltaTime;
+
+    // Both chase the same frame time target, and the SDF's share of the frame moves with the render scale.
+    // The render scale reacts faster, so it takes over while it is adapting
+    const bool adaptingRenderScale = dynamicResolution && computeRenderer && temporalUpscale;
+    if (adaptiveSDFReduction && !adaptingRenderScale) {
+        adaptSDFReduction(deltaTime);
+    }
+    if (adaptingRenderScale) {
+        adaptRenderScale();
+    }
 
      float orbitDistanceChange = static_cast<float>(simulationSettings.grid_size) / 8.0f;
 
@@ -427,12 +2033,97 @@ void MoldLabGame::update(float deltaTime) {
 
 
 void MoldLabGame::render() {
-    // While using the
-    glUseProgram(shaderProgram);
+    renderTimer.begin();
 
-    // Draw the full-screen quad
-    glBindVertexArray(triangleVao);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (!computeRenderer || !renderTiles()) {
+        // Binding the depth cache can rebuild the program, so it goes first
+        bindDepthCache(getScreenWidth(), getScreenHeight());
+        coneMarch(getScreenWidth(), getScreenHeight());
+        glUseProgram(shaderProgram);
+
+        // Draw the full-screen quad
+        glBindVertexArray(triangleVao);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    renderTimer.end();
+
+    // This frame is what the next one reprojects from
+    for (int i = 0; i < 4; i++) {
+        simulationSettings.previous_camera_position[i] = simulationSettings.camera_position[i];
+        simulationSettings.previous_camera_focus[i] = simulationSettings.camera_focus[i];
+    }
+}
+
+// Ray marches the screen in 8x8 pixel tiles with render_tiles.glsl and blits the result. When upscaling, the march
+// runs at renderScale and temporal_upscale.glsl reprojects last frame's output onto it at the screen resolution.
+// False if the images could not be allocated, the fragment shader has to draw the frame instead
+bool MoldLabGame::renderTiles() {
+    const int width = getScreenWidth();
+    const int height = getScreenHeight();
+    if (width < 1 || height < 1) {
+        return true; // Minimized, nothing to draw
+    }
+
+    const float scale = temporalUpscale ? renderScale : 1.0f;
+    const int renderWidth = std::max(1, static_cast<int>(std::lround(static_cast<float>(width) * scale)));
+    const int renderHeight = std::max(1, static_cast<int>(std::lround(static_cast<float>(height) * scale)));
+
+    if ((renderWidth != renderTargetWidth || renderHeight != renderTargetHeight) && !initializeRenderTarget(renderWidth, renderHeight)) {
+        std::cerr << "Out of memory for the render target, switching back to the fragment shader renderer" << std::endl;
+        computeRenderer = false;
+        return false;
+    }
+    if (temporalUpscale && (width != historyWidth || height != historyHeight) && !initializeHistoryTextures(width, height)) {
+        std::cerr << "Out of memory for the upscaling history, disabling temporal upscaling" << std::endl;
+        temporalUpscale = false;
+        return false;
+    }
+
+    bindDepthCache(renderWidth, renderHeight);
+    coneMarch(renderWidth, renderHeight);
+    glBindImageTexture(RENDER_TARGET_LOCATION, renderTargetTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    if (!temporalUpscale) {
+        DispatchComputeShader(renderTilesShaderProgram, width, height, 1);
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        blitToScreen(renderTargetTexture, width, height);
+        return true;
+    }
+
+    // The checkerboard marches the other half of the pixels every frame
+    glUseProgram(upscaledRenderTilesShaderProgram);
+    checkerboardPhase = checkerboardRendering ? simulationSettings.frame_index & 1 : -1;
+    checkerboardPhaseSV.uploadToShader();
+    DispatchComputeShader(upscaledRenderTilesShaderProgram, renderWidth, renderHeight, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glActiveTexture(GL_TEXTURE0 + CURRENT_FRAME_TEXTURE_LOCATION);
+    glBindTexture(GL_TEXTURE_2D, renderTargetTexture);
+    glActiveTexture(GL_TEXTURE0 + HISTORY_TEXTURE_LOCATION);
+    glBindTexture(GL_TEXTURE_2D, historyTexture1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(RENDER_TARGET_LOCATION, historyTexture2, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    glUseProgram(temporalUpscaleShaderProgram);
+    historyValidSV.uploadToShader();
+    DispatchComputeShader(temporalUpscaleShaderProgram, width, height, 1);
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    blitToScreen(historyTexture2, width, height);
+
+    // This frame's output is what the next frame reprojects from
+    std::swap(historyTexture1, historyTexture2);
+    historyValid = 1;
+    return true;
+}
+
+// Copies a screen sized image to the default framebuffer
+void MoldLabGame::blitToScreen(const GLuint texture, const int width, const int height) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderTargetFramebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 bool SliderFloatWithTooltip(const char* label, const char* sliderId, float* value, float min, float max, const char* tooltip) {
@@ -501,36 +2192,32 @@ void MoldLabGame::renderUI() {
     SliderIntWithTooltip("Spore Count", "##SporeCountSlider", &simulationSettings.spore_count, 1, SimulationDefaults::MAX_SPORE_COUNT, "Number of spores in the simulation.");
 
     int previousGridSize = simulationSettings.grid_size;
-    gridSizeChanged = SliderIntWithTooltip("Grid Size", "##GridSizeSlider", &simulationSettings.grid_size, 25,
+    const bool gridSizeChanged = SliderIntWithTooltip("Grid Size", "##GridSizeSlider", &simulationSettings.grid_size, 25,
                          SimulationDefaults::MAX_GRID_SIZE,
                          "The number of voxels that make up one side length of the cube grid. "
-                         "\nNote: This will Clear the current voxels and randomize spore positions. Will also scale grid-size dependent settings with it");
+                         "\nNote: The current voxels and spore positions are rescaled to the new size. Will also scale grid-size dependent settings with it");
 
     if (gridSizeChanged) {
-        // Ensure grid_size is divisible by sdf_reduction
-        int reduction = simulationSettings.sdf_reduction;
-        simulationSettings.grid_size = (simulationSettings.grid_size / reduction) * reduction;
-
         if (previousGridSize != simulationSettings.grid_size) {
             float gridResizeFactor = static_cast<float>(simulationSettings.grid_size) / static_cast<float>(previousGridSize);
             simulationSettings.spore_speed *= gridResizeFactor;
             simulationSettings.sensor_distance *= gridResizeFactor;
 
             orbitRadius *= gridResizeFactor;
-
-            simulationSettings.grid_resize_factor = gridResizeFactor;
         }
     }
 
-    if  (simulationSettings.grid_size % simulationSettings.sdf_reduction != 0) {
-        // ReSharper disable once CppDFAUnreachableCode
-        std::cerr << "Warning: GRID_SIZE is not evenly divisible by SDF_REDUCTION_FACTOR!" << std::endl;
-    }
     SliderFloatWithTooltip("Spore Speed", "##SporeSpeedSlider", &simulationSettings.spore_speed, 0.0f, static_cast<float>(simulationSettings.grid_size) / 2.0f, "Sets the speed of the spores. Voxels per second.");
     SliderFloatWithTooltip("Turn Speed", "##TurnSpeedSlider", &simulationSettings.turn_speed, 0.0f, 5.0f, "Turn speed of spores. Rotations per second.");
     SliderFloatWithTooltip("Decay Speed", "##DecaySpeedSlider", &simulationSettings.decay_speed, 0.0f, 10.0f, "Decay speed of spores. 1/x seconds to fully decay.");
     SliderFloatWithTooltip("Sensor Distance", "##SensorDistanceSlider", &simulationSettings.sensor_distance, 0.0f, static_cast<float>(simulationSettings.grid_size) / 2.0f, "Sets the distance that the spore can see. In Voxels.");
     SliderFloatWithTooltip("Sensor Angle", "##SensorAngleSlider", &simulationSettings.sensor_angle, 0.0f, SimulationDefaults::PI, "Sets the angle that the spores see. In Radians. 0 is directly on the forward sensor, PI being directly behind it.");
+    if (useDiffusion) {
+        SliderFloatWithTooltip("Diffuse Speed", "##DiffuseSpeedSlider", &simulationSettings.diffuse_speed, 0.0f, 20.0f, "How quickly trails blur into neighbouring voxels. Per second.");
+    }
+    if (atomicDeposit) {
+        SliderFloatWithTooltip("Deposit Amount", "##DepositAmountSlider", &simulationSettings.deposit_amount, 0.0f, 1.0f, "Trail each spore adds to its voxel per frame. Voxels are capped at 1.");
+    }
 
     ImGui::Spacing();
     ImGui::Separator();
@@ -547,18 +2234,254 @@ void MoldLabGame::renderUI() {
     bool previousTransparentState = useTransparency; // Track the previous state
     if (ImGui::Checkbox("Use Transparency", &useTransparency)) {
         if (useTransparency != previousTransparentState) {
-            initializeRenderShader(useTransparency);
+            initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+        }
+    }
+
+    if (ImGui::Checkbox("Cone Pre-pass", &conePrepass)) {
+        initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Marches one cone per 8x8 pixel block against the SDF first, and starts the block's rays where its cone stopped. Not used by the pyramid ray march, which has no SDF");
+    }
+
+    // Spores crossing a face of the wrapped grid deposit on the opposite one, in front of the cached hits
+    ImGui::BeginDisabled(wrapGrid);
+    if (ImGui::Checkbox("Depth Cache", &depthCache)) {
+        initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+        ImGui::SetTooltip("%s", "Starts each ray a little short of where last frame's rays around it hit trail, instead of marching the empty space from the grid bounds again. "
+                                "Only helps while the camera moves slowly and every pixel is marched. Needs Wrap Grid off, as wrapping spores make trail appear away from the trail already there");
+    }
+    ImGui::EndDisabled();
+
+    ImGui::Checkbox("Compute Renderer", &computeRenderer);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Ray marches 8x8 pixel tiles in a compute shader that shares the trail voxels its rays reach, instead of every pixel in a fragment shader");
+    }
+
+    if (computeRenderer) {
+        if (ImGui::Checkbox("Temporal Upscaling", &temporalUpscale)) {
+            historyValid = 0;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s", "Marches at the render scale and fills in the screen resolution from the previous frame, reprojected with the camera movement");
         }
+
+        if (temporalUpscale) {
+            ImGui::Checkbox("Dynamic Resolution", &dynamicResolution);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", "Adjusts the render scale every frame to keep the measured GPU time under the target frame time");
+            }
+
+            if (dynamicResolution) {
+                SliderFloatWithTooltip("Target Frame Time", "##ResolutionTargetFrameTimeSlider", &targetFrameTime, 4.0f, 50.0f, "GPU milliseconds per frame the render scale is adapted to.");
+                ImGui::Text("Render Scale: %.0f%% (%dx%d)  Render Time: %.2f ms", renderScale * 100.0f,
+                            renderTargetWidth, renderTargetHeight, renderTimer.getMilliseconds());
+            } else {
+                SliderFloatWithTooltip("Render Scale", "##RenderScaleSlider", &renderScale, SimulationDefaults::MIN_RENDER_SCALE, 1.0f, "Internal resolution of the ray march, relative to the window.");
+            }
+            ImGui::Checkbox("Checkerboard", &checkerboardRendering);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", "Marches every other pixel, alternating each frame, and fills the rest in from their neighbours");
+            }
+        }
+    }
+
+    bool previousPyramidState = pyramidMarch; // Track the previous state
+    if (ImGui::Checkbox("Pyramid Ray March", &pyramidMarch) && pyramidMarch != previousPyramidState) {
+        if (pyramidMarch && !initializePyramidBuffer()) {
+            std::cerr << "Out of memory for the trail pyramid" << std::endl;
+            pyramidMarch = false;
+        }
+        initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Opaque rendering skips empty space with a max pyramid of the trail grid instead of the jump flood SDF, which is then not built at all");
     }
 
 
     bool previousWrappingState = wrapGrid; // Track the previous state
     if (ImGui::Checkbox("Wrap Grid", &wrapGrid)) {
         if (wrapGrid != previousWrappingState) {
+            // Trail wrapping around would appear in front of the cached hits
+            depthCache = depthCache && !wrapGrid;
             initializeMoveSporesShader(wrapGrid);
+            initializeDiffusionShader(separableDiffusion);
+            initializeJumpFloodShaders();
+            initializeUniformVariables(); // The jump flood uniforms belonged to the deleted programs
+            initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+            sdfHistoryValid = false; // Distances across the faces changed meaning
+        }
+    }
+
+    if (wrapGrid) {
+        ImGui::BeginDisabled(useTransparency || pyramidMarch);
+        if (ImGui::Checkbox("Tiled View", &tiledView)) {
+            initializeRenderShader(useTransparency, pyramidMarch, tiledView && wrapGrid, depthCache, conePrepass);
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+            ImGui::SetTooltip("%s", "Renders the wrapped grid as an endlessly repeating space, opaque SDF ray marching only");
+        }
+        ImGui::EndDisabled();
+    }
+
+    // Applied by reallocateGrid() at the start of the next simulation step
+    if (ImGui::BeginCombo("Voxel Format", VOXEL_FORMATS[voxelFormat].name)) {
+        for (int i = 0; i < static_cast<int>(std::size(VOXEL_FORMATS)); i++) {
+            // Sparse bricks are handed back by the decay pass, which lazy decay skips
+            const ImGuiSelectableFlags flags = sparseGrid && VOXEL_FORMATS[i].lazyDecay ? ImGuiSelectableFlags_Disabled : 0;
+            if (ImGui::Selectable(VOXEL_FORMATS[i].name, i == voxelFormat, flags)) {
+                voxelFormat = i;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Storage format of the trail grid. R16F and R8 use half and a quarter of the memory bandwidth and dither decay so slow decay still happens. "
+                                "Lazy Decay stores when each voxel was written and decays it on read, replacing the decay pass over the grid");
+    }
+
+    const bool lazyDecay = VOXEL_FORMATS[voxelFormat].lazyDecay;
+    if (lazyDecay) {
+        // Every voxel has to be read to diffuse or resolve deposits, which is what lazy decay avoids
+        useDiffusion = false;
+        atomicDeposit = false;
+    }
+
+    ImGui::BeginDisabled(lazyDecay);
+    if (ImGui::Checkbox("Sparse Grid", &sparseGrid) && sparseGrid) {
+        // The brick pool only supports plain decay and non-atomic deposits
+        useDiffusion = false;
+        atomicDeposit = false;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Stores only bricks that hold trail, so mostly empty grids use a fraction of the memory. The brick pool grows as trails spread");
+    }
+    ImGui::EndDisabled();
+
+    if (allocatedSparseGrid) {
+        const int poolBricks = simulationSettings.sparse_pool_side * simulationSettings.sparse_pool_side * sparsePoolLayers;
+        ImGui::Text("Brick Pool: %d / %d bricks used", poolBricks - sparsePoolFreeBricks, poolBricks);
+        if (sparsePoolDroppedBricks > 0) {
+            ImGui::SameLine();
+            ImGui::Text(" %d dropped, pool is full", sparsePoolDroppedBricks);
+        }
+    }
+
+    ImGui::BeginDisabled(sparseGrid || lazyDecay);
+    if (ImGui::Checkbox("Diffusion", &useDiffusion) && useDiffusion && !initializeDiffusedVoxelGridBuffer()) {
+        std::cerr << "Out of memory for the diffusion grid" << std::endl;
+        useDiffusion = false;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Blurs trails into their neighbours as part of the decay pass");
+    }
+
+    if (useDiffusion) {
+        ImGui::SameLine();
+        bool previousSeparableState = separableDiffusion; // Track the previous state
+        if (ImGui::Checkbox("Separable Kernel", &separableDiffusion)) {
+            if (separableDiffusion != previousSeparableState) {
+                initializeDiffusionShader(separableDiffusion);
+            }
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s", "On: [1 2 1] blur along each axis. Off: 3x3x3 box blur");
+        }
+    }
+
+
+    ImGui::Checkbox("Fused Spore Step", &fuseSporeStep);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Moves and deposits spores in a single pass instead of a move pass followed by a draw pass");
+    }
+
+    bool previousAtomicState = atomicDeposit; // Track the previous state
+    if (ImGui::Checkbox("Atomic Deposition", &atomicDeposit)) {
+        if (atomicDeposit != previousAtomicState) {
+            if (atomicDeposit && !initializeDepositGridBuffer()) {
+                std::cerr << "Out of memory for the deposit grid" << std::endl;
+                atomicDeposit = false;
+            }
+            initializeDepositShaders(atomicDeposit);
         }
     }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Accumulates spore trails with atomic adds instead of overwriting the voxel, so dense areas don't saturate");
+    }
+    ImGui::EndDisabled();
+
+    if (ImGui::Checkbox("Sort Spores", &sortSpores) && sortSpores && sortCapacity < sporeCapacity) {
+        initializeSortBuffers(sporeCapacity);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Periodically reorders spores along a Morton curve so neighbouring spores are processed together");
+    }
+
+    if (sortSpores) {
+        SliderIntWithTooltip("Sort Interval", "##SortIntervalSlider", &sortInterval, 1, 240, "Frames between re-sorting the spores.");
+        ImGui::Text("Sort Time: %.2f ms", sortTimer.getMilliseconds());
+    }
+
+    ImGui::Checkbox("Temporal JFA", &temporalJFA);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Updates last frame's SDF with a few short jump flood passes instead of rebuilding it every frame");
+    }
+
+    if (temporalJFA) {
+        SliderIntWithTooltip("JFA Passes", "##TemporalJFAPassesSlider", &temporalJFAPasses, 1, 4, "Step passes per frame, the first one jumps 2^(passes - 1) cells.");
+        SliderIntWithTooltip("JFA Rebuild Interval", "##JFARebuildIntervalSlider", &jfaRebuildInterval, 1, 240, "Frames between full rebuilds of the SDF.");
+    }
+    ImGui::Checkbox("Separable JFA", &separableJFA);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Floods along x, then y, then z with 2 neighbours per step instead of all 26 neighbours at once");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Compare")) {
+        compareSDFBuilders();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Rebuilds the SDF with both jump floods and measures how far the separable one is from the 26 neighbour one");
+    }
+    if (sdfComparison.measured) {
+        ImGui::Text("Mean Error: %.3f  Max Error: %.2f  Mismatched: %.2f%%", sdfComparison.meanError, sdfComparison.maxError, sdfComparison.mismatchFraction * 100.0f);
+    }
+    if (ImGui::Checkbox("Amortized JFA", &amortizedJFA) && !initializeSDFBuffer()) {
+        std::cerr << "Out of memory for the amortized SDF" << std::endl;
+        amortizedJFA = false;
+        if (!initializeSDFBuffer()) {
+            throw std::runtime_error("Out of memory allocating the SDF");
+        }
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Spreads full SDF rebuilds over several frames while rendering the last finished one, padded by how far trails can have grown since. Takes over from the temporal JFA");
+    }
+    if (amortizedJFA) {
+        ImGui::Text("Rebuilt over %d frames, margin %.2f voxels", amortizedJFAFrames, simulationSettings.sdf_margin);
+    }
+    ImGui::Text("JFA Time: %.2f ms", jfaTimer.getMilliseconds());
+
+    ImGui::Checkbox("Adaptive SDF Reduction", &adaptiveSDFReduction);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", "Every few seconds picks the SDF reduction that keeps the measured GPU time under the target frame time. Paused while Dynamic Resolution adapts the render scale");
+    }
 
+    if (adaptiveSDFReduction) {
+        SliderFloatWithTooltip("Target Frame Time", "##TargetFrameTimeSlider", &targetFrameTime, 4.0f, 50.0f, "GPU milliseconds per frame the SDF reduction is adapted to.");
+        ImGui::Text("SDF Reduction: %d  GPU Time: %.2f ms", simulationSettings.sdf_reduction,
+                    simulationTimer.getMilliseconds() + jfaTimer.getMilliseconds() + renderTimer.getMilliseconds());
+    } else {
+        int reductionLevel = 0; // log2 of sdf_reduction
+        while ((1 << reductionLevel) < simulationSettings.sdf_reduction) {
+            reductionLevel++;
+        }
+        const char *reductionNames[] = {"1", "2", "4", "8"};
+        if (ImGui::Combo("SDF Reduction", &reductionLevel, reductionNames, static_cast<int>(std::size(reductionNames)))) {
+            setSDFReduction(1 << reductionLevel);
+        }
+    }
 
     // Add VSync toggle at the top
     bool currentVSync = GetVsyncStatus();